@@ -0,0 +1,239 @@
+// Barriers.h
+// 단계별로 동기화하는 작업에서 사용하는 배리어 구현을 모은 헤더 전용 라이브러리 (Locks.h와 같은 방식)
+// 모든 배리어는 스레드마다 BarrierLocal 하나를 가지고 wait 함수에 넘긴다
+#pragma once
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <threads.h>
+#include <windows.h>
+
+#pragma comment(lib, "Synchronization.lib") // WaitOnAddress / WakeByAddressAll
+
+#ifndef CACHE_LINE
+#define CACHE_LINE (64)
+#endif
+
+#define BARRIER_FANIN (4)           // 결합 트리의 노드 하나에 모이는 참가자 수
+#define BARRIER_MAX_ROUNDS (16)     // 분산 배리어의 최대 라운드 수 (스레드 2^16개까지)
+#define BARRIER_SPIN_LIMIT (1 << 10) // 이만큼 돌아도 풀리지 않으면 그때부터는 돌 때마다 양보한다
+
+// 스레드별 상태
+// sense : 지금까지 통과한 배리어 횟수의 홀짝 (중앙/트리 배리어)
+// parity : 분산 배리어가 번갈아 사용하는 플래그 묶음
+typedef struct BarrierLocal {
+	int id;
+	bool sense;
+	int parity;
+} BarrierLocal;
+
+static inline BarrierLocal init_barrier_local(int id) {
+	BarrierLocal l;
+	l.id = id;
+	l.sense = false;
+	l.parity = 0;
+
+	return l;
+}
+
+// 코어보다 스레드가 많으면 기다리는 스레드가 풀어 줄 스레드의 실행을 막으므로 오래 돌면 양보한다
+static inline void barrier_pause(int* spins) {
+	if (++*spins > BARRIER_SPIN_LIMIT) {
+		thrd_yield();
+	}
+}
+
+// Sense-reversing Barrier (중앙 카운터)
+// 마지막으로 도착한 스레드가 count를 되돌리고 sense를 뒤집으면, 나머지는 sense가 자신의 값이 될 때까지 기다린다
+typedef struct SenseBarrier {
+	alignas(CACHE_LINE) atomic_int count;
+	atomic_bool sense;
+	int n;
+} SenseBarrier;
+
+static inline void init_sense_barrier(SenseBarrier* barrier, int n) {
+	atomic_init(&barrier->count, n);
+	atomic_init(&barrier->sense, false);
+	barrier->n = n;
+}
+
+static inline void sense_barrier_wait(SenseBarrier* barrier, BarrierLocal* local) {
+	local->sense = !local->sense;
+	if (atomic_fetch_sub(&barrier->count, 1) == 1) {
+		atomic_store(&barrier->count, barrier->n);
+		atomic_store(&barrier->sense, local->sense);
+		return;
+	}
+	int spins = 0;
+	while (atomic_load(&barrier->sense) != local->sense) {
+		barrier_pause(&spins);
+	}
+}
+
+// Combining-tree Barrier
+// 참가자를 BARRIER_FANIN개씩 묶은 노드에서 마지막으로 도착한 스레드만 부모 노드로 올라간다
+// 한 카운터에 몰리는 스레드가 BARRIER_FANIN개 이하이고, 풀 때는 루트부터 내려오면서 노드별 sense를 뒤집는다
+typedef struct TreeBarrierNode {
+	alignas(CACHE_LINE) atomic_int count;
+	atomic_bool sense;
+	int n; // 이 노드에 모이는 참가자(스레드 또는 자식 노드) 수
+	struct TreeBarrierNode* parent;
+} TreeBarrierNode;
+
+typedef struct TreeBarrier {
+	TreeBarrierNode* nodes; // 잎 노드부터 레벨 순서로 (스레드 i의 잎은 nodes[i / BARRIER_FANIN])
+	int node_num;
+} TreeBarrier;
+
+// 노드를 할당하지 못하면 false (barrier는 사용할 수 없다)
+static inline bool init_tree_barrier(TreeBarrier* barrier, int n) {
+	int node_num = 0;
+	for (int level = n; level > 1; level = (level + BARRIER_FANIN - 1) / BARRIER_FANIN) {
+		node_num += (level + BARRIER_FANIN - 1) / BARRIER_FANIN;
+	}
+	if (node_num == 0) {
+		node_num = 1; // 스레드가 하나여도 노드 하나는 있어야 한다
+	}
+	barrier->nodes = (TreeBarrierNode*)_aligned_malloc(sizeof(TreeBarrierNode) * node_num, CACHE_LINE);
+	barrier->node_num = node_num;
+	if (barrier->nodes == NULL) {
+		return false;
+	}
+
+	// level_size개의 참가자를 BARRIER_FANIN개씩 묶어 위 레벨을 만든다
+	int offset = 0;
+	int level_size = n;
+	do {
+		int parents = (level_size + BARRIER_FANIN - 1) / BARRIER_FANIN;
+		for (int j = 0; j < parents; ++j) {
+			TreeBarrierNode* node = &barrier->nodes[offset + j];
+			int members = level_size - j * BARRIER_FANIN;
+			node->n = members < BARRIER_FANIN ? members : BARRIER_FANIN;
+			atomic_init(&node->count, node->n);
+			atomic_init(&node->sense, false);
+			node->parent = parents > 1 ? &barrier->nodes[offset + parents + j / BARRIER_FANIN] : NULL;
+		}
+		offset += parents;
+		level_size = parents;
+	} while (level_size > 1);
+
+	return true;
+}
+
+static inline void destroy_tree_barrier(TreeBarrier* barrier) {
+	_aligned_free(barrier->nodes);
+	barrier->nodes = NULL;
+}
+
+static inline void tree_node_wait(TreeBarrierNode* node, bool sense) {
+	if (atomic_fetch_sub(&node->count, 1) == 1) {
+		if (node->parent != NULL) {
+			tree_node_wait(node->parent, sense);
+		}
+		atomic_store(&node->count, node->n);
+		atomic_store(&node->sense, sense);
+		return;
+	}
+	int spins = 0;
+	while (atomic_load(&node->sense) != sense) {
+		barrier_pause(&spins);
+	}
+}
+
+static inline void tree_barrier_wait(TreeBarrier* barrier, BarrierLocal* local) {
+	local->sense = !local->sense;
+	tree_node_wait(&barrier->nodes[local->id / BARRIER_FANIN], local->sense);
+}
+
+// Dissemination Barrier
+// r번째 라운드에서 스레드 i는 (i + 2^r) % n번 스레드에게 알리고 자신에게 올 알림을 기다린다
+// ceil(log2 n) 라운드가 지나면 모든 스레드가 서로의 도착을 (간접적으로) 알게 된다. 공유 카운터가 없다
+// 플래그는 두 묶음(parity)을 번갈아 쓰고, 두 번에 한 번씩 쓰는 값을 뒤집어서 플래그를 초기화하지 않는다
+typedef struct DisseminationFlags {
+	alignas(CACHE_LINE) atomic_bool flags[2][BARRIER_MAX_ROUNDS];
+} DisseminationFlags;
+
+typedef struct DisseminationBarrier {
+	DisseminationFlags* threads;
+	int n;
+	int rounds;
+} DisseminationBarrier;
+
+// 라운드 수가 BARRIER_MAX_ROUNDS를 넘거나 (flags 배열 밖을 쓰게 된다) 할당에 실패하면 false (barrier는 사용할 수 없다)
+static inline bool init_dissemination_barrier(DisseminationBarrier* barrier, int n) {
+	barrier->threads = NULL;
+	barrier->n = n;
+	barrier->rounds = 0;
+	while ((1 << barrier->rounds) < n) {
+		++barrier->rounds;
+		if (barrier->rounds > BARRIER_MAX_ROUNDS) {
+			return false;
+		}
+	}
+	barrier->threads = (DisseminationFlags*)_aligned_malloc(sizeof(DisseminationFlags) * n, CACHE_LINE);
+	if (barrier->threads == NULL) {
+		return false;
+	}
+	for (int i = 0; i < n; ++i) {
+		for (int p = 0; p < 2; ++p) {
+			for (int r = 0; r < BARRIER_MAX_ROUNDS; ++r) {
+				atomic_init(&barrier->threads[i].flags[p][r], false);
+			}
+		}
+	}
+
+	return true;
+}
+
+static inline void destroy_dissemination_barrier(DisseminationBarrier* barrier) {
+	_aligned_free(barrier->threads);
+	barrier->threads = NULL;
+}
+
+static inline void dissemination_barrier_wait(DisseminationBarrier* barrier, BarrierLocal* local) {
+	bool value = !local->sense; // 처음 두 번은 true를 쓰고, 그다음 두 번은 false를 쓴다
+	DisseminationFlags* mine = &barrier->threads[local->id];
+	for (int r = 0; r < barrier->rounds; ++r) {
+		DisseminationFlags* partner = &barrier->threads[(local->id + (1 << r)) % barrier->n];
+		atomic_store(&partner->flags[local->parity][r], value);
+		int spins = 0;
+		while (atomic_load(&mine->flags[local->parity][r]) != value) {
+			barrier_pause(&spins);
+		}
+	}
+	if (local->parity == 1) {
+		local->sense = !local->sense;
+	}
+	local->parity = 1 - local->parity;
+}
+
+// WaitOnAddress 기반 Barrier
+// 마지막으로 도착한 스레드가 generation을 올리고 모두 깨운다. 기다리는 스레드는 돌지 않고 잠든다
+typedef struct FutexBarrier {
+	alignas(CACHE_LINE) atomic_int count;
+	atomic_int generation;
+	int n;
+} FutexBarrier;
+
+static inline void init_futex_barrier(FutexBarrier* barrier, int n) {
+	atomic_init(&barrier->count, 0);
+	atomic_init(&barrier->generation, 0);
+	barrier->n = n;
+}
+
+static inline void futex_barrier_wait(FutexBarrier* barrier, BarrierLocal* local) {
+	(void)local;
+	int generation = atomic_load(&barrier->generation);
+	if (atomic_fetch_add(&barrier->count, 1) == barrier->n - 1) {
+		// count를 먼저 되돌린 뒤 generation을 올리므로, 깨어난 스레드가 다음 배리어에 들어와도 count는 0부터 센다
+		atomic_store(&barrier->count, 0);
+		atomic_fetch_add(&barrier->generation, 1);
+		WakeByAddressAll(&barrier->generation);
+		return;
+	}
+	while (atomic_load(&barrier->generation) == generation) {
+		WaitOnAddress(&barrier->generation, &generation, sizeof(generation), INFINITE);
+	}
+}
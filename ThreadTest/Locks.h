@@ -0,0 +1,1079 @@
+// Locks.h
+// ThreadTest에서 사용하는 락 구현을 모은 헤더 전용 라이브러리
+// 모든 함수는 static inline이므로 이 헤더를 포함하기만 하면 되고, 호출하는 쪽의 루프 안으로 인라인될 수 있다
+//
+// 계측 훅: 이 헤더를 포함하기 전에 TRACE_ACQUIRE_BEGIN/TRACE_ACQUIRE_END/TRACE_ACQUIRE_ABORT/TRACE_RELEASE (lock)와
+// STATS_SPIN/STATS_FAILED_CAS/STATS_SLEEP/STATS_ACQUIRED/STATS_TRY_FAILED (lock) 매크로를 정의하면 락 함수가 그것을 호출한다
+// 정의하지 않으면 아무 코드도 만들지 않는다
+#pragma once
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include <windows.h>
+
+#pragma comment(lib, "Synchronization.lib") // WaitOnAddress / WakeByAddressSingle
+
+#ifndef CACHE_LINE
+#define CACHE_LINE (64)
+#endif
+
+#define LOCK_READER_SLOTS (64) // BigReaderLock의 읽기 슬롯 수
+
+#ifndef TRACE_ACQUIRE_BEGIN
+#define TRACE_ACQUIRE_BEGIN(lock) ((void)0)
+#endif
+#ifndef TRACE_ACQUIRE_END
+#define TRACE_ACQUIRE_END(lock) ((void)0)
+#endif
+#ifndef TRACE_ACQUIRE_ABORT
+#define TRACE_ACQUIRE_ABORT(lock) ((void)0)
+#endif
+#ifndef TRACE_RELEASE
+#define TRACE_RELEASE(lock) ((void)0)
+#endif
+#ifndef STATS_ACQUIRED
+#define STATS_ACQUIRED(lock) ((void)0)
+#endif
+#ifndef STATS_SPIN
+#define STATS_SPIN(lock) ((void)0)
+#endif
+#ifndef STATS_FAILED_CAS
+#define STATS_FAILED_CAS(lock) ((void)0)
+#endif
+#ifndef STATS_SLEEP
+#define STATS_SLEEP(lock) ((void)0)
+#endif
+#ifndef STATS_TRY_FAILED
+#define STATS_TRY_FAILED(lock) ((void)0)
+#endif
+
+typedef struct AtomicLock {
+	atomic_int state;
+} AtomicLock;
+
+// Initialize the TASLock
+static inline void init_atomic_lock(AtomicLock* lock) {
+	atomic_init(&lock->state, 0);
+}
+
+// Acquire the TASLock using atomic_fetch_and_add
+
+// 이 코드를 사용하면 데드락 문제와 값이 덮어쓰기되는 문제가 발생하지 않음
+// atomic_fetch_add : 스레드끼리 값을 공유하면서 증가시키는 함수일 뿐이다
+// 이때 값은 fetch와 add할 때 각각은 원자성을 보장하나 fetch와 add을 동시에 할 때는 원자성을 보장하지 않는다
+// atomic_compare_exchange_waek : 이 함수는 변수의 현재 값과 기대 값(expected value)을 비교합니다. 
+// 현재 값이 기대 값과 같으면 새 값(desired value)으로 교환하고, 그렇지 않으면 실패를 반환합니다. 
+// 이 함수는 실패할 가능성이 있기 때문에 반복적인 시도에 적합합니다
+// atomic_exchange : 변수의 값을 새 값으로 설정하고 이전 값을 원자적으로 반환(단일 교환 연산이 필요한 경우 사용한다)
+
+static inline void tas_lock(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int expected = 0;
+	while (true) {
+		expected = 0; // 기대 값을 초기화
+		if (atomic_compare_exchange_weak(&lock->state, &expected, 1)) {
+			break; // 락 획득 성공
+		}
+		STATS_FAILED_CAS(lock);
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void ttas_lock(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	while (true) {
+		// 첫 번째 테스트: 상태가 0인지 확인
+		if (atomic_load(&lock->state) == 0) {
+			// 두 번째 테스트: 비교 후 교환 시도
+			int expected = 0;
+			if (atomic_compare_exchange_weak(&lock->state, &expected, 1)) {
+				break; // 락 획득 성공
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		// 락 획득 실패 시 반복 시도
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void back_off_lock(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+    int backoff_time = 20; // 초기 백오프 시간 (밀리초 단위)
+	while (true) {
+		// 첫 번째 테스트: 상태가 0인지 확인
+		if (atomic_load(&lock->state) == 0) {
+			// 두 번째 테스트: 비교 후 교환 시도
+			int expected = 0;
+			if (atomic_compare_exchange_weak(&lock->state, &expected, 1)) {
+				break; // 락 획득 성공
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		// 락 획득 실패 후 일정 시간 대기 (지수 백오프)
+		STATS_SLEEP(lock);
+		Sleep(backoff_time);
+		backoff_time *= 2; // 백오프 시간 두 배로 증가
+		if (backoff_time > 1000) { // 최대 백오프 시간 제한 (1초)
+			backoff_time = 1000;
+		}
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+// Try-lock / Timed lock
+// trylock : 한 번만 시도하고 바로 결과를 반환한다
+// lock_timeout : deadline(clock() 기준)까지만 시도하고, 그때까지 얻지 못하면 false를 반환한다
+// (deadline이 이미 지났어도 최소 한 번은 시도한다)
+
+static inline bool tas_trylock(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	// 한 번만 시도하므로 가짜 실패가 없는 strong 버전을 사용한다
+	int expected = 0;
+	if (atomic_compare_exchange_strong(&lock->state, &expected, 1)) {
+		STATS_ACQUIRED(lock);
+		TRACE_ACQUIRE_END(lock);
+		return true;
+	}
+	STATS_FAILED_CAS(lock);
+	STATS_TRY_FAILED(lock);
+	TRACE_ACQUIRE_ABORT(lock);
+	return false;
+}
+
+static inline bool tas_lock_timeout(AtomicLock* lock, clock_t deadline) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int expected = 0;
+	do {
+		expected = 0;
+		if (atomic_compare_exchange_weak(&lock->state, &expected, 1)) {
+			STATS_ACQUIRED(lock);
+			TRACE_ACQUIRE_END(lock);
+			return true;
+		}
+		STATS_FAILED_CAS(lock);
+		STATS_SPIN(lock);
+	} while (clock() < deadline);
+	STATS_TRY_FAILED(lock);
+	TRACE_ACQUIRE_ABORT(lock);
+	return false;
+}
+
+// 상태를 읽어 보고 비어 있을 때만 CAS를 한 번 시도한다 (획득/실패는 호출하는 쪽이 센다)
+static inline bool ttas_try_acquire(AtomicLock* lock) {
+	if (atomic_load(&lock->state) != 0) {
+		return false;
+	}
+	int expected = 0;
+	if (atomic_compare_exchange_strong(&lock->state, &expected, 1)) {
+		return true;
+	}
+	STATS_FAILED_CAS(lock);
+	return false;
+}
+
+static inline bool ttas_trylock(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	if (ttas_try_acquire(lock)) {
+		STATS_ACQUIRED(lock);
+		TRACE_ACQUIRE_END(lock);
+		return true;
+	}
+	STATS_TRY_FAILED(lock);
+	TRACE_ACQUIRE_ABORT(lock);
+	return false;
+}
+
+static inline bool ttas_lock_timeout(AtomicLock* lock, clock_t deadline) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	do {
+		if (atomic_load(&lock->state) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_weak(&lock->state, &expected, 1)) {
+				STATS_ACQUIRED(lock);
+				TRACE_ACQUIRE_END(lock);
+				return true;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SPIN(lock);
+	} while (clock() < deadline);
+	STATS_TRY_FAILED(lock);
+	TRACE_ACQUIRE_ABORT(lock);
+	return false;
+}
+
+// 기다리지 않으므로 백오프가 없고 ttas_trylock과 같다
+static inline bool back_off_trylock(AtomicLock* lock) {
+	return ttas_trylock(lock);
+}
+
+static inline bool back_off_lock_timeout(AtomicLock* lock, clock_t deadline) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int backoff_time = 20; // 초기 백오프 시간 (밀리초 단위)
+	while (true) {
+		if (ttas_try_acquire(lock)) {
+			STATS_ACQUIRED(lock);
+			TRACE_ACQUIRE_END(lock);
+			return true;
+		}
+		clock_t now = clock();
+		if (now >= deadline) {
+			STATS_TRY_FAILED(lock);
+			TRACE_ACQUIRE_ABORT(lock);
+			return false;
+		}
+		// deadline을 넘겨서 자지 않도록 남은 시간만큼만 잔다
+		long remaining = (long)((deadline - now) * 1000 / CLOCKS_PER_SEC);
+		STATS_SLEEP(lock);
+		Sleep(backoff_time < remaining ? backoff_time : remaining);
+		backoff_time *= 2;
+		if (backoff_time > 1000) {
+			backoff_time = 1000;
+		}
+	}
+}
+
+// Release the TASLock
+static inline void atomic_unlock(AtomicLock* lock) {
+	TRACE_RELEASE(lock);
+	atomic_store(&lock->state, 0);
+}
+
+// Memory ordering 변형
+// 위의 락은 기본(seq_cst) 원자 연산을 사용한다. 아래는 acquire/release, relaxed, strong/weak CAS로 바꾼 변형이다
+// _acq : 획득은 acquire, 실패/대기 중 읽기는 relaxed
+// _relaxed : 모든 연산이 relaxed (임계 구역이 락 밖으로 새어 나갈 수 있으므로 틀린 구현이다. 검증기가 걸러내는지 확인하는 용도)
+// _strong : compare_exchange_weak 대신 compare_exchange_strong 사용
+
+static inline void tas_lock_strong(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int expected = 0;
+	while (true) {
+		expected = 0;
+		if (atomic_compare_exchange_strong(&lock->state, &expected, 1)) {
+			break;
+		}
+		STATS_FAILED_CAS(lock);
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void tas_lock_acq(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int expected = 0;
+	while (true) {
+		expected = 0;
+		if (atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1, memory_order_acquire, memory_order_relaxed)) {
+			break;
+		}
+		STATS_FAILED_CAS(lock);
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void tas_lock_acq_strong(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int expected = 0;
+	while (true) {
+		expected = 0;
+		if (atomic_compare_exchange_strong_explicit(&lock->state, &expected, 1, memory_order_acquire, memory_order_relaxed)) {
+			break;
+		}
+		STATS_FAILED_CAS(lock);
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void tas_lock_relaxed(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int expected = 0;
+	while (true) {
+		expected = 0;
+		if (atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1, memory_order_relaxed, memory_order_relaxed)) {
+			break;
+		}
+		STATS_FAILED_CAS(lock);
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void ttas_lock_strong(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	while (true) {
+		if (atomic_load(&lock->state) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_strong(&lock->state, &expected, 1)) {
+				break;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void ttas_lock_acq(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	while (true) {
+		if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1, memory_order_acquire, memory_order_relaxed)) {
+				break;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void ttas_lock_acq_strong(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	while (true) {
+		if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_strong_explicit(&lock->state, &expected, 1, memory_order_acquire, memory_order_relaxed)) {
+				break;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void ttas_lock_relaxed(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	while (true) {
+		if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void back_off_lock_strong(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int backoff_time = 20; // 초기 백오프 시간 (밀리초 단위)
+	while (true) {
+		if (atomic_load(&lock->state) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_strong(&lock->state, &expected, 1)) {
+				break;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SLEEP(lock);
+		Sleep(backoff_time);
+		backoff_time *= 2;
+		if (backoff_time > 1000) {
+			backoff_time = 1000;
+		}
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void back_off_lock_acq(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int backoff_time = 20; // 초기 백오프 시간 (밀리초 단위)
+	while (true) {
+		if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1, memory_order_acquire, memory_order_relaxed)) {
+				break;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SLEEP(lock);
+		Sleep(backoff_time);
+		backoff_time *= 2;
+		if (backoff_time > 1000) {
+			backoff_time = 1000;
+		}
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void back_off_lock_acq_strong(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int backoff_time = 20; // 초기 백오프 시간 (밀리초 단위)
+	while (true) {
+		if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_strong_explicit(&lock->state, &expected, 1, memory_order_acquire, memory_order_relaxed)) {
+				break;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SLEEP(lock);
+		Sleep(backoff_time);
+		backoff_time *= 2;
+		if (backoff_time > 1000) {
+			backoff_time = 1000;
+		}
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void back_off_lock_relaxed(AtomicLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	int backoff_time = 20; // 초기 백오프 시간 (밀리초 단위)
+	while (true) {
+		if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_weak_explicit(&lock->state, &expected, 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SLEEP(lock);
+		Sleep(backoff_time);
+		backoff_time *= 2;
+		if (backoff_time > 1000) {
+			backoff_time = 1000;
+		}
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+// release store는 x86에서 일반 mov로 컴파일되어 seq_cst store의 전체 펜스(xchg/mfence)가 없어진다
+static inline void atomic_unlock_release(AtomicLock* lock) {
+	TRACE_RELEASE(lock);
+	atomic_store_explicit(&lock->state, 0, memory_order_release);
+}
+
+static inline void atomic_unlock_relaxed(AtomicLock* lock) {
+	TRACE_RELEASE(lock);
+	atomic_store_explicit(&lock->state, 0, memory_order_relaxed);
+}
+
+// Ticket Lock
+// 번호표를 뽑고 now_serving이 자신의 번호가 될 때까지 기다린다 (FIFO)
+typedef struct TicketLock {
+	atomic_uint next_ticket;
+	atomic_uint now_serving;
+} TicketLock;
+
+// MCS Lock
+// 각 스레드는 자신의 노드의 locked 필드만 보면서 기다리고, 락을 놓는 스레드가 다음 노드의 locked를 풀어 준다
+typedef struct MCSNode {
+	_Atomic(struct MCSNode*) next;
+	atomic_bool locked;
+	char pad[CACHE_LINE - sizeof(void*) - sizeof(atomic_bool)];
+} MCSNode;
+
+typedef struct MCSLock {
+	_Atomic(MCSNode*) tail;
+} MCSLock;
+
+static inline void init_ticket_lock(TicketLock* lock) {
+	atomic_init(&lock->next_ticket, 0);
+	atomic_init(&lock->now_serving, 0);
+}
+
+static inline void ticket_lock(TicketLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	unsigned int ticket = atomic_fetch_add(&lock->next_ticket, 1);
+	while (atomic_load(&lock->now_serving) != ticket) {
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void ticket_unlock(TicketLock* lock) {
+	TRACE_RELEASE(lock);
+	// now_serving은 락을 가진 스레드만 수정한다
+	unsigned int serving = atomic_load_explicit(&lock->now_serving, memory_order_relaxed);
+	atomic_store(&lock->now_serving, serving + 1);
+}
+
+static inline void init_mcs_lock(MCSLock* lock) {
+	atomic_init(&lock->tail, NULL);
+}
+
+static inline void mcs_lock(MCSLock* lock, MCSNode* node) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+	atomic_store_explicit(&node->locked, true, memory_order_relaxed);
+	MCSNode* pred = atomic_exchange(&lock->tail, node);
+	if (pred != NULL) {
+		atomic_store(&pred->next, node);
+		while (atomic_load(&node->locked)) {
+			STATS_SPIN(lock);
+		}
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void mcs_unlock(MCSLock* lock, MCSNode* node) {
+	TRACE_RELEASE(lock);
+	MCSNode* next = atomic_load(&node->next);
+	if (next == NULL) {
+		MCSNode* expected = node;
+		if (atomic_compare_exchange_strong(&lock->tail, &expected, NULL)) {
+			return; // 기다리는 스레드가 없음
+		}
+		// 뒤 스레드가 tail에는 들어왔지만 아직 next를 연결하지 않았다
+		while ((next = atomic_load(&node->next)) == NULL) {
+		}
+	}
+	atomic_store(&next->locked, false);
+}
+
+// Abortable queue lock (TOLock: 시간 제한이 있는 CLH 큐 락)
+// 각 스레드는 자신의 노드를 tail에 넣고 앞 노드(pred)의 pred 필드만 보면서 기다린다
+// 노드의 pred 필드 : NULL이면 주인이 기다리거나 락을 가지고 있음, 그 노드 자신이면 락을 놓았음,
+//                    그 외의 값이면 주인이 포기하고 큐를 떠났음 (값은 그 노드의 앞 노드)
+// 포기한 노드는 뒤 스레드가 건너뛰어 간다. 더 이상 아무도 보지 않는 노드는 그 노드를 마지막으로 본 스레드가 가져가서 재사용한다
+typedef struct TONode {
+	_Atomic(struct TONode*) pred;
+	struct TONode* next_free;  // 스레드별 재사용 목록
+	struct TONode* next_alloc; // 락이 할당한 모든 노드 목록 (해제용)
+	char pad[CACHE_LINE - 3 * sizeof(void*)];
+} TONode;
+
+typedef struct TOLock {
+	_Atomic(TONode*) tail;
+	_Atomic(TONode*) allocated;
+} TOLock;
+
+// 스레드별 상태: 지금 사용 중인 노드와 재사용할 수 있는 노드 목록
+typedef struct TOThreadNode {
+	TONode* my_node;
+	TONode* free_list;
+} TOThreadNode;
+
+static inline void init_to_lock(TOLock* lock) {
+	atomic_init(&lock->tail, NULL);
+	atomic_init(&lock->allocated, NULL);
+}
+
+// 모든 스레드가 끝난 뒤에 호출한다
+static inline void destroy_to_lock(TOLock* lock) {
+	TONode* node = atomic_load(&lock->allocated);
+	while (node != NULL) {
+		TONode* next = node->next_alloc;
+		free(node);
+		node = next;
+	}
+	atomic_store(&lock->allocated, NULL);
+}
+
+static inline void to_release_node(TOThreadNode* thread_node, TONode* node) {
+	node->next_free = thread_node->free_list;
+	thread_node->free_list = node;
+}
+
+static inline TONode* to_get_node(TOLock* lock, TOThreadNode* thread_node) {
+	TONode* node = thread_node->free_list;
+	if (node != NULL) {
+		thread_node->free_list = node->next_free;
+	}
+	else {
+		node = (TONode*)malloc(sizeof(TONode));
+		node->next_alloc = atomic_load(&lock->allocated);
+		while (!atomic_compare_exchange_weak(&lock->allocated, &node->next_alloc, node)) {
+		}
+	}
+	atomic_store_explicit(&node->pred, NULL, memory_order_relaxed);
+	return node;
+}
+
+static inline bool to_acquire(TOLock* lock, TOThreadNode* thread_node, bool timed, clock_t deadline) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	TONode* node = to_get_node(lock, thread_node);
+	thread_node->my_node = node;
+	TONode* pred = atomic_exchange(&lock->tail, node);
+	if (pred == NULL) {
+		STATS_ACQUIRED(lock);
+		TRACE_ACQUIRE_END(lock);
+		return true; // 락 획득 성공 (큐가 비어 있었음)
+	}
+	while (true) {
+		TONode* pred_pred = atomic_load(&pred->pred);
+		if (pred_pred == pred) {
+			// 앞 노드의 주인은 락을 놓고 떠났으므로 이제 아무도 이 노드를 보지 않는다
+			to_release_node(thread_node, pred);
+			STATS_ACQUIRED(lock);
+			TRACE_ACQUIRE_END(lock);
+			return true; // 락 획득 성공
+		}
+		if (pred_pred != NULL) {
+			// 앞 노드의 주인이 포기했으므로 건너뛴다
+			// 포기한 노드는 시간과 상관없이 끝까지 건너뛴다. 여기서 시간 초과로 나가면 포기한 노드가 하나 더 쌓이고,
+			// 경합 중에는 쌓이는 속도가 건너뛰는 속도보다 빨라져서 락이 비어 있어도 trylock이 계속 실패한다
+			to_release_node(thread_node, pred);
+			pred = pred_pred;
+			continue;
+		}
+		// 앞에 살아 있는 대기자나 주인이 있을 때만 시간 초과를 확인한다
+		STATS_SPIN(lock);
+		if (timed && clock() >= deadline) {
+			break;
+		}
+	}
+	// 시간 초과: 큐에서 빠져나간다
+	STATS_TRY_FAILED(lock);
+	TRACE_ACQUIRE_ABORT(lock);
+	TONode* expected = node;
+	if (atomic_compare_exchange_strong(&lock->tail, &expected, pred)) {
+		to_release_node(thread_node, node); // 뒤에 아무도 없었으므로 바로 재사용할 수 있다
+	}
+	else {
+		atomic_store(&node->pred, pred); // 뒤 스레드가 이 노드를 건너뛰도록 앞 노드를 알려 준다
+	}
+	thread_node->my_node = NULL;
+	return false;
+}
+
+static inline void to_lock(TOLock* lock, TOThreadNode* thread_node) {
+	to_acquire(lock, thread_node, false, 0);
+}
+
+static inline bool to_trylock(TOLock* lock, TOThreadNode* thread_node) {
+	return to_acquire(lock, thread_node, true, 0);
+}
+
+static inline bool to_lock_timeout(TOLock* lock, TOThreadNode* thread_node, clock_t deadline) {
+	return to_acquire(lock, thread_node, true, deadline);
+}
+
+static inline void to_unlock(TOLock* lock, TOThreadNode* thread_node) {
+	TRACE_RELEASE(lock);
+	TONode* node = thread_node->my_node;
+	TONode* expected = node;
+	if (atomic_compare_exchange_strong(&lock->tail, &expected, NULL)) {
+		to_release_node(thread_node, node); // 뒤에 아무도 없음
+	}
+	else {
+		atomic_store(&node->pred, node); // 뒤 스레드에게 넘긴다 (노드는 뒤 스레드가 가져간다)
+	}
+	thread_node->my_node = NULL;
+}
+
+// Reader-Writer Lock
+// state : -1이면 쓰기 스레드가 락을 가지고 있음, 0이면 비어 있음, n > 0이면 n개의 읽기 스레드가 락을 가지고 있음
+// waiting_writers : 쓰기 우선 락에서 대기 중인 쓰기 스레드 수 (새로 들어오는 읽기 스레드를 막는 데 사용)
+typedef struct RWLock {
+	atomic_int state;
+	atomic_int waiting_writers;
+} RWLock;
+
+// Big-reader Lock
+// 읽기 스레드는 자신의 슬롯(캐시 라인 하나)만 수정하므로 읽기끼리는 공유 캐시 라인에 쓰지 않는다
+// 쓰기 스레드는 writer 락을 잡은 뒤 모든 슬롯이 0이 될 때까지 기다린다
+typedef struct ReaderSlot {
+	alignas(CACHE_LINE) atomic_int active; // 슬롯마다 캐시 라인 하나 (패딩만으로는 두 줄에 걸칠 수 있다)
+	char pad[CACHE_LINE - sizeof(atomic_int)];
+} ReaderSlot;
+
+typedef struct BigReaderLock {
+	AtomicLock writer;
+	ReaderSlot readers[LOCK_READER_SLOTS];
+} BigReaderLock;
+
+static inline void init_rw_lock(RWLock* lock) {
+	atomic_init(&lock->state, 0);
+	atomic_init(&lock->waiting_writers, 0);
+}
+
+static inline void init_big_reader_lock(BigReaderLock* lock) {
+	init_atomic_lock(&lock->writer);
+	for (int i = 0; i < LOCK_READER_SLOTS; ++i) {
+		atomic_init(&lock->readers[i].active, 0);
+	}
+}
+
+static inline void rw_read_lock(RWLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	while (true) {
+		// 쓰기 스레드가 없을 때만 읽기 스레드 수를 하나 늘린다
+		int state = atomic_load(&lock->state);
+		if (state >= 0) {
+			if (atomic_compare_exchange_weak(&lock->state, &state, state + 1)) {
+				break; // 락 획득 성공
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void rw_write_lock(RWLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	while (true) {
+		if (atomic_load(&lock->state) == 0) {
+			int expected = 0;
+			if (atomic_compare_exchange_weak(&lock->state, &expected, -1)) {
+				break; // 락 획득 성공
+			}
+			STATS_FAILED_CAS(lock);
+		}
+		STATS_SPIN(lock);
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+// 쓰기 우선 락: 기다리는 쓰기 스레드가 있으면 새 읽기 스레드는 들어가지 않는다
+// (읽기가 끊임없이 들어와서 쓰기 스레드가 굶는 문제를 막는다)
+static inline void rw_pref_read_lock(RWLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	while (true) {
+		if (atomic_load(&lock->waiting_writers) == 0) {
+			int state = atomic_load(&lock->state);
+			if (state >= 0) {
+				if (atomic_compare_exchange_weak(&lock->state, &state, state + 1)) {
+					break; // 락 획득 성공
+				}
+				STATS_FAILED_CAS(lock);
+			}
+		}
+		STATS_SPIN(lock); // 쓰기 스레드가 기다리는 동안에도 센다
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void rw_pref_write_lock(RWLock* lock) {
+	atomic_fetch_add(&lock->waiting_writers, 1);
+	rw_write_lock(lock);
+	atomic_fetch_sub(&lock->waiting_writers, 1);
+}
+
+static inline void rw_read_unlock(RWLock* lock) {
+	TRACE_RELEASE(lock);
+	atomic_fetch_sub(&lock->state, 1);
+}
+
+static inline void rw_write_unlock(RWLock* lock) {
+	TRACE_RELEASE(lock);
+	atomic_store(&lock->state, 0);
+}
+
+// 슬롯은 카운터이므로 스레드가 LOCK_READER_SLOTS개보다 많아도 슬롯을 나눠 쓸 수 있다
+static inline void br_read_lock(BigReaderLock* lock, int id) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	ReaderSlot* slot = &lock->readers[id % LOCK_READER_SLOTS];
+	while (true) {
+		// 먼저 자신의 슬롯에 표시한 다음 쓰기 스레드가 없는지 확인한다
+		atomic_fetch_add(&slot->active, 1);
+		if (atomic_load(&lock->writer.state) == 0) {
+			break; // 락 획득 성공
+		}
+		// 쓰기 스레드가 있으면 표시를 지우고 쓰기가 끝날 때까지 기다린다
+		atomic_fetch_sub(&slot->active, 1);
+		STATS_FAILED_CAS(lock); // CAS는 아니지만 들어가려다 물러난 시도
+		while (atomic_load(&lock->writer.state) != 0) {
+			STATS_SPIN(lock);
+		}
+	}
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void br_read_unlock(BigReaderLock* lock, int id) {
+	TRACE_RELEASE(lock);
+	atomic_fetch_sub(&lock->readers[id % LOCK_READER_SLOTS].active, 1);
+}
+
+static inline void br_write_lock(BigReaderLock* lock) {
+	ttas_lock(&lock->writer);
+	// 이미 들어와 있는 읽기 스레드가 모두 나갈 때까지 기다린다
+	for (int i = 0; i < LOCK_READER_SLOTS; ++i) {
+		while (atomic_load(&lock->readers[i].active) != 0) {
+			STATS_SPIN(lock);
+		}
+	}
+}
+
+static inline void br_write_unlock(BigReaderLock* lock) {
+	atomic_unlock(&lock->writer);
+}
+
+// Sequence Lock
+// 쓰기 스레드는 값을 바꾸기 전후로 seq를 하나씩 증가시킨다 (seq가 홀수면 쓰는 중)
+// 읽기 스레드는 공유 캐시 라인에 아무것도 쓰지 않고, 읽기 전후의 seq가 같은 짝수일 때만 읽은 값을 사용한다
+// 쓰기 스레드끼리의 상호 배제는 다른 락으로 한다
+typedef struct SeqLock {
+	atomic_uint seq;
+} SeqLock;
+
+static inline void init_seq_lock(SeqLock* lock) {
+	atomic_init(&lock->seq, 0);
+}
+
+static inline void seq_write_begin(SeqLock* lock) {
+	unsigned int seq = atomic_load_explicit(&lock->seq, memory_order_relaxed);
+	atomic_store_explicit(&lock->seq, seq + 1, memory_order_relaxed);
+	// 홀수 seq가 데이터 쓰기보다 먼저 보이도록 한다
+	atomic_thread_fence(memory_order_release);
+}
+
+static inline void seq_write_end(SeqLock* lock) {
+	unsigned int seq = atomic_load_explicit(&lock->seq, memory_order_relaxed);
+	atomic_store_explicit(&lock->seq, seq + 1, memory_order_release);
+}
+
+static inline unsigned int seq_read_begin(SeqLock* lock) {
+	unsigned int seq;
+	// 쓰는 중(홀수)이면 끝날 때까지 기다린다
+	while ((seq = atomic_load_explicit(&lock->seq, memory_order_acquire)) & 1) {
+	}
+	return seq;
+}
+
+// 읽는 동안 쓰기가 있었으면 true (다시 읽어야 한다)
+static inline bool seq_read_retry(SeqLock* lock, unsigned int seq) {
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&lock->seq, memory_order_relaxed) != seq;
+}
+
+// 시스템의 논리 코어 수
+static inline int lock_cpu_count(void) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+}
+
+// Adaptive Lock
+// 배타성은 항상 state 하나로 보장하고, 기다리는 방식만 최근 경합 정도에 따라 바꾼다
+// - ADAPTIVE_TTAS: 경합이 거의 없을 때. state를 읽어 보고 비어 있을 때만 CAS
+// - ADAPTIVE_QUEUE: 몇 개의 스레드가 경쟁할 때. 티켓 순서대로 한 스레드씩만 state를 두고 경쟁해서 CAS 폭주를 막는다
+// - ADAPTIVE_PARK: 기다리는 스레드가 코어 수만큼 쌓였을 때. 잠깐 돌아 본 뒤 WaitOnAddress로 잠든다
+// 경합 정도는 락을 얻은 시점에 느린 경로에서 기다리던 스레드 수의 지수 이동 평균(EWMA)이다
+// 평균과 모드는 락을 가진 스레드만 바꾸므로 별도의 동기화가 필요 없다
+#define ADAPTIVE_TTAS (0)
+#define ADAPTIVE_QUEUE (1)
+#define ADAPTIVE_PARK (2)
+
+#define ADAPTIVE_SCALE (16)     // contention의 고정 소수점 배율
+#define ADAPTIVE_DECAY (3)      // 새 표본의 가중치 1/8
+#define ADAPTIVE_SPIN_LIMIT (100) // PARK 모드에서 잠들기 전에 돌아 보는 횟수
+
+static const char* const ADAPTIVE_MODE_NAMES[3] = { "TTAS", "Queue", "Park" };
+
+typedef struct AdaptiveLock {
+	atomic_int state; // 0: 비어 있음, 1: 잡혀 있음
+	atomic_int mode;
+	int contention; // 느린 경로에서 기다리던 스레드 수의 EWMA (ADAPTIVE_SCALE배)
+	int cores;
+	long long switches;
+	alignas(CACHE_LINE) atomic_int contenders; // 느린 경로에 들어와 있는 스레드 수
+	atomic_int waiters; // WaitOnAddress로 잠들었거나 잠들려는 스레드 수
+	alignas(CACHE_LINE) atomic_uint next_ticket;
+	atomic_uint now_serving;
+} AdaptiveLock;
+
+static inline void init_adaptive_lock(AdaptiveLock* lock) {
+	atomic_init(&lock->state, 0);
+	atomic_init(&lock->mode, ADAPTIVE_TTAS);
+	lock->contention = 0;
+	lock->cores = lock_cpu_count();
+	lock->switches = 0;
+	atomic_init(&lock->contenders, 0);
+	atomic_init(&lock->waiters, 0);
+	atomic_init(&lock->next_ticket, 0);
+	atomic_init(&lock->now_serving, 0);
+}
+
+static inline bool adaptive_try_state(AdaptiveLock* lock) {
+	int expected = 0;
+	return atomic_load_explicit(&lock->state, memory_order_relaxed) == 0 &&
+		atomic_compare_exchange_strong(&lock->state, &expected, 1);
+}
+
+static inline void adaptive_spin_state(AdaptiveLock* lock) {
+	while (!adaptive_try_state(lock)) {
+		STATS_SPIN(lock);
+	}
+}
+
+static inline void adaptive_park_state(AdaptiveLock* lock) {
+	for (int i = 0; i < ADAPTIVE_SPIN_LIMIT; ++i) {
+		if (adaptive_try_state(lock)) {
+			return;
+		}
+		STATS_SPIN(lock);
+	}
+	// waiters를 먼저 올린 뒤에 state를 다시 보므로, 해제하는 스레드는 깨울 대상을 놓치지 않는다
+	atomic_fetch_add(&lock->waiters, 1);
+	while (true) {
+		int expected = 0;
+		if (atomic_compare_exchange_strong(&lock->state, &expected, 1)) {
+			break;
+		}
+		int held = 1;
+		STATS_SLEEP(lock);
+		WaitOnAddress(&lock->state, &held, sizeof(held), INFINITE);
+	}
+	atomic_fetch_sub(&lock->waiters, 1);
+}
+
+// 락을 가진 스레드가 호출한다. 히스테리시스를 두어 경계 근처에서 모드가 계속 바뀌지 않게 한다
+static inline void adaptive_update(AdaptiveLock* lock, int waiting) {
+	lock->contention += (waiting * ADAPTIVE_SCALE - lock->contention) >> ADAPTIVE_DECAY;
+
+	int mode = atomic_load_explicit(&lock->mode, memory_order_relaxed);
+	int next = mode;
+	int queue_enter = 2 * ADAPTIVE_SCALE;
+	int queue_leave = ADAPTIVE_SCALE / 2;
+	int park_enter = lock->cores * ADAPTIVE_SCALE;
+	int park_leave = park_enter / 2;
+	if (lock->contention >= park_enter && lock->contention >= queue_enter) {
+		next = ADAPTIVE_PARK;
+	}
+	else if (mode == ADAPTIVE_PARK && lock->contention >= park_leave) {
+		next = ADAPTIVE_PARK;
+	}
+	else if (lock->contention >= queue_enter || (mode != ADAPTIVE_TTAS && lock->contention >= queue_leave)) {
+		next = ADAPTIVE_QUEUE;
+	}
+	else {
+		next = ADAPTIVE_TTAS;
+	}
+	if (next != mode) {
+		atomic_store_explicit(&lock->mode, next, memory_order_relaxed);
+		++lock->switches;
+	}
+}
+
+static inline void adaptive_lock(AdaptiveLock* lock) {
+	TRACE_ACQUIRE_BEGIN(lock);
+	// 빠른 경로: 비어 있으면 바로 얻는다
+	if (adaptive_try_state(lock)) {
+		adaptive_update(lock, atomic_load_explicit(&lock->contenders, memory_order_relaxed));
+		STATS_ACQUIRED(lock);
+		TRACE_ACQUIRE_END(lock);
+		return;
+	}
+	STATS_FAILED_CAS(lock);
+
+	atomic_fetch_add(&lock->contenders, 1);
+	switch (atomic_load_explicit(&lock->mode, memory_order_relaxed)) {
+	case ADAPTIVE_TTAS:
+		adaptive_spin_state(lock);
+		break;
+	case ADAPTIVE_QUEUE: {
+		// 차례가 온 스레드 하나만 state를 두고 경쟁한다 (빠른 경로로 들어온 스레드와는 경쟁할 수 있다)
+		unsigned int ticket = atomic_fetch_add(&lock->next_ticket, 1);
+		while (atomic_load(&lock->now_serving) != ticket) {
+			STATS_SPIN(lock);
+		}
+		adaptive_spin_state(lock);
+		atomic_store(&lock->now_serving, ticket + 1);
+		break;
+	}
+	default:
+		adaptive_park_state(lock);
+		break;
+	}
+	int waiting = atomic_fetch_sub(&lock->contenders, 1) - 1;
+	adaptive_update(lock, waiting);
+	STATS_ACQUIRED(lock);
+	TRACE_ACQUIRE_END(lock);
+}
+
+static inline void adaptive_unlock(AdaptiveLock* lock) {
+	TRACE_RELEASE(lock);
+	// 모드와 관계없이 잠든 스레드가 있으면 깨운다 (PARK 모드를 벗어난 뒤에도 남아 있을 수 있다)
+	atomic_store(&lock->state, 0);
+	if (atomic_load(&lock->waiters) > 0) {
+		WakeByAddressSingle(&lock->state);
+	}
+}
+
+// Async Mutex
+// 락을 얻지 못한 쪽은 스핀하거나 스레드를 재우지 않고 대기열에 들어가서 멈춘다 (태스크/코루틴용)
+// 락을 놓는 쪽은 locked를 그대로 둔 채 대기열의 다음 대기자에게 락을 직접 넘기고, 그 대기자를 돌려준다
+// 돌려받은 대기자를 다시 실행시키는 것은 호출한 쪽의 일이다 (넘겨받은 쪽은 STATS_ACQUIRED를 직접 기록한다)
+typedef struct AsyncWaiter {
+	struct AsyncWaiter* next;
+} AsyncWaiter;
+
+typedef struct AsyncMutex {
+	AtomicLock guard; // locked와 대기열을 보호 (아주 짧게만 잡는다)
+	bool locked;
+	AsyncWaiter* waiters_head;
+	AsyncWaiter* waiters_tail;
+} AsyncMutex;
+
+static inline void init_async_mutex(AsyncMutex* mutex) {
+	init_atomic_lock(&mutex->guard);
+	mutex->locked = false;
+	mutex->waiters_head = NULL;
+	mutex->waiters_tail = NULL;
+}
+
+// 락을 얻으면 true. 얻지 못하면 waiter를 대기열에 넣고 false (나중에 async_mutex_unlock이 락과 함께 돌려준다)
+static inline bool async_mutex_lock(AsyncMutex* mutex, AsyncWaiter* waiter) {
+	ttas_lock(&mutex->guard);
+	if (!mutex->locked) {
+		mutex->locked = true;
+		atomic_unlock(&mutex->guard);
+		STATS_ACQUIRED(&mutex->locked); // guard와 주소가 겹치지 않도록 locked를 키로 사용한다
+		return true;
+	}
+	STATS_SLEEP(&mutex->locked); // 대기자가 대기열에서 잠든다
+	waiter->next = NULL;
+	if (mutex->waiters_tail == NULL) {
+		mutex->waiters_head = waiter;
+	}
+	else {
+		mutex->waiters_tail->next = waiter;
+	}
+	mutex->waiters_tail = waiter;
+	atomic_unlock(&mutex->guard);
+	return false;
+}
+
+// 락을 넘겨받은 대기자를 돌려준다 (없으면 NULL, 락은 풀린다)
+static inline AsyncWaiter* async_mutex_unlock(AsyncMutex* mutex) {
+	ttas_lock(&mutex->guard);
+	AsyncWaiter* next = mutex->waiters_head;
+	if (next != NULL) {
+		// locked는 그대로 두고 다음 대기자에게 넘긴다
+		mutex->waiters_head = next->next;
+		if (mutex->waiters_head == NULL) {
+			mutex->waiters_tail = NULL;
+		}
+	}
+	else {
+		mutex->locked = false;
+	}
+	atomic_unlock(&mutex->guard);
+	return next;
+}
@@ -1,9 +1,15 @@
 #include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdalign.h>
 #include <stdatomic.h>
 #include <stdbool.h>
 #include <time.h>
 #include <threads.h>
 #include <windows.h>
+#include <winternl.h>
+
+#pragma comment(lib, "ntdll.lib") // NtQuerySystemInformation
 
 #define TWO (2)
 #define FOUR (4)
@@ -12,13 +18,526 @@
 #define THIRTYTWO (32)
 #define SIXTYFOUR (64)
 
+#define CACHE_LINE (64)
+
 unsigned long long int sum = 0;
 const int MIN_NUM = 1000000;
 const int MAX_NUM = 5000000;
+const int WRITE_PERCENT = 5; // 읽기 위주 테스트에서 쓰기 연산의 비율 (%)
+const clock_t TRY_TIMEOUT = CLOCKS_PER_SEC / 1000; // lock_timeout 테스트에서 한 번에 기다리는 최대 시간 (1ms)
+const int PREEMPT_INTERVAL = 1000;     // 선점 주입 테스트에서 몇 번째 임계 구역마다 선점을 흉내 낼지
+const int PREEMPT_DELAY_SPINS = 20000; // PREEMPT_DELAY 모드에서 임계 구역 안에서 도는 횟수
+
+// 스레드 수를 바꿔가며 반복하는 테스트에서 사용하는 스레드 수 목록
+const int THREAD_COUNTS[] = { TWO, FOUR, EIGHT, SIXTEEN, THIRTYTWO, SIXTYFOUR };
+#define THREAD_COUNT_NUM (6)
+
+// 고해상도 시간 측정 (clock()은 지연 시간을 재기에는 해상도가 낮다)
+long long now_ticks(void) {
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+double ticks_to_us(long long ticks) {
+	static long long frequency = 0;
+	if (frequency == 0) {
+		LARGE_INTEGER f;
+		QueryPerformanceFrequency(&f);
+		frequency = f.QuadPart;
+	}
+	return (double)ticks * 1000000.0 / (double)frequency;
+}
+
+// 락 이벤트 추적
+// LOCK_TRACE를 정의하면 락 함수가 획득 시작/획득 완료(또는 포기)/해제 시각을 스레드별 링 버퍼에 기록하고,
+// trace_test()가 thrd_join 이후 Chrome trace JSON (chrome://tracing, Perfetto)으로 저장한다
+// 정의하지 않으면 TRACE_* 매크로는 아무 코드도 만들지 않는다
+// #define LOCK_TRACE
+
+#ifdef LOCK_TRACE
+#define TRACE_BUFFER_SIZE (1 << 11) // 스레드별 기록 수 (넘치면 오래된 기록부터 덮어쓴다)
+#define TRACE_MAX_THREADS (4096)
+
+// 한 번의 락 사용 (획득 시작 -> 획득 완료 -> 해제, 또는 획득 시작 -> 포기)
+typedef struct TraceRecord {
+	const void* lock;
+	long long begin;
+	long long acquired; // 포기한 경우 포기한 시각
+	long long released;
+	bool aborted; // trylock/lock_timeout이 락을 얻지 못하고 돌아감
+} TraceRecord;
+
+typedef struct TraceBuffer {
+	int tid;
+	long long count;
+	TraceRecord pending; // 아직 해제되지 않은 획득
+	TraceRecord records[TRACE_BUFFER_SIZE];
+} TraceBuffer;
+
+TraceBuffer* trace_buffers[TRACE_MAX_THREADS];
+atomic_int trace_buffer_count;
+atomic_bool trace_enabled; // trace_start()와 trace_stop() 사이에 만든 스레드만 기록한다
+long long trace_origin;
+_Thread_local TraceBuffer* trace_local;
+
+TraceBuffer* trace_buffer(void) {
+	if (trace_local == NULL && atomic_load_explicit(&trace_enabled, memory_order_relaxed)) {
+		int index = atomic_fetch_add(&trace_buffer_count, 1);
+		if (index >= TRACE_MAX_THREADS) {
+			return NULL;
+		}
+		TraceBuffer* buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+		buffer->tid = index;
+		trace_buffers[index] = buffer;
+		trace_local = buffer;
+	}
+	return trace_local;
+}
+
+void trace_acquire_begin(const void* lock) {
+	TraceBuffer* buffer = trace_buffer();
+	if (buffer != NULL) {
+		buffer->pending.lock = lock;
+		buffer->pending.begin = now_ticks();
+		buffer->pending.aborted = false;
+	}
+}
+
+void trace_acquire_end(const void* lock) {
+	TraceBuffer* buffer = trace_buffer();
+	if (buffer != NULL && buffer->pending.lock == lock) {
+		buffer->pending.acquired = now_ticks();
+	}
+}
+
+void trace_release(const void* lock) {
+	TraceBuffer* buffer = trace_buffer();
+	if (buffer == NULL || buffer->pending.lock != lock) {
+		return; // 추적하지 않은 획득
+	}
+	TraceRecord* record = &buffer->records[buffer->count % TRACE_BUFFER_SIZE];
+	*record = buffer->pending;
+	record->released = now_ticks();
+	buffer->pending.lock = NULL;
+	++buffer->count;
+}
+
+// 락을 얻지 못하고 돌아간 시도도 대기 구간만 있는 기록으로 남긴다
+void trace_acquire_abort(const void* lock) {
+	TraceBuffer* buffer = trace_buffer();
+	if (buffer == NULL || buffer->pending.lock != lock) {
+		return;
+	}
+	TraceRecord* record = &buffer->records[buffer->count % TRACE_BUFFER_SIZE];
+	*record = buffer->pending;
+	record->acquired = now_ticks();
+	record->released = record->acquired;
+	record->aborted = true;
+	buffer->pending.lock = NULL;
+	++buffer->count;
+}
+
+// 이전 기록을 모두 버리고 추적을 시작한다 (스레드를 만들기 전에 호출)
+void trace_start(void) {
+	int count = atomic_load(&trace_buffer_count);
+	for (int i = 0; i < count && i < TRACE_MAX_THREADS; ++i) {
+		free(trace_buffers[i]);
+		trace_buffers[i] = NULL;
+	}
+	atomic_store(&trace_buffer_count, 0);
+	trace_origin = now_ticks();
+	atomic_store(&trace_enabled, true);
+}
+
+void trace_stop(void) {
+	atomic_store(&trace_enabled, false);
+}
+
+// 기록마다 대기(wait)와 보유(hold) 구간을 complete 이벤트("ph":"X")로 저장한다
+// 포기한 시도는 "wait (aborted)" 구간 하나만 저장한다
+void trace_dump(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		printf("Error opening %s\n", path);
+		return;
+	}
+	fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	bool first = true;
+	int count = atomic_load(&trace_buffer_count);
+	for (int i = 0; i < count && i < TRACE_MAX_THREADS; ++i) {
+		TraceBuffer* buffer = trace_buffers[i];
+		long long from = buffer->count > TRACE_BUFFER_SIZE ? buffer->count - TRACE_BUFFER_SIZE : 0;
+		for (long long r = from; r < buffer->count; ++r) {
+			TraceRecord* record = &buffer->records[r % TRACE_BUFFER_SIZE];
+			fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"lock\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"lock\":\"%p\"}}\n",
+				first ? "" : ",", record->aborted ? "wait (aborted)" : "wait", buffer->tid,
+				ticks_to_us(record->begin - trace_origin), ticks_to_us(record->acquired - record->begin), record->lock);
+			first = false;
+			if (record->aborted) {
+				continue;
+			}
+			fprintf(file, ",{\"name\":\"hold\",\"cat\":\"lock\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"lock\":\"%p\"}}\n",
+				buffer->tid, ticks_to_us(record->acquired - trace_origin), ticks_to_us(record->released - record->acquired), record->lock);
+		}
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+}
+
+#define TRACE_ACQUIRE_BEGIN(lock) trace_acquire_begin(lock)
+#define TRACE_ACQUIRE_END(lock) trace_acquire_end(lock)
+#define TRACE_ACQUIRE_ABORT(lock) trace_acquire_abort(lock)
+#define TRACE_RELEASE(lock) trace_release(lock)
+#else
+#define TRACE_ACQUIRE_BEGIN(lock) ((void)0)
+#define TRACE_ACQUIRE_END(lock) ((void)0)
+#define TRACE_ACQUIRE_ABORT(lock) ((void)0)
+#define TRACE_RELEASE(lock) ((void)0)
+#endif
+
+// 락 계측 카운터
+// LOCK_STATS를 정의하면 락 함수가 (락, 스레드)마다 대기 중 스핀 횟수, 실패한 CAS 횟수, 획득 횟수,
+// 같은 스레드가 연속으로 다시 얻은 횟수(stickiness), Sleep 횟수, trylock/lock_timeout이 락을 얻지 못하고 돌아간 횟수를 센다
+// 카운터는 스레드마다 따로 가진 표에 락 주소를 키로 저장하므로 스레드끼리 캐시 라인을 공유하지 않고, 락끼리 섞이지도 않는다
+// 각 테스트는 시간 결과 옆에 STATS_PRINT로 락마다 합계를 출력한다 (STATS_NAME으로 락에 이름을 붙일 수 있다)
+// 정의하지 않으면 STATS_* 매크로는 아무 코드도 만들지 않는다
+// #define LOCK_STATS
+
+#ifdef LOCK_STATS
+#define STATS_MAX_THREADS (4096)
+#define STATS_OWNER_SLOTS (4096) // 락마다 마지막 소유 스레드를 기록하는 표의 크기 (open addressing)
+#define STATS_MAX_NAMES (128)
+#define STATS_PRINT_LOCKS (8)    // 락이 이보다 많으면 획득 횟수가 많은 순서로 이만큼만 따로 출력하고 나머지는 합쳐서 출력한다
+
+typedef struct LockStats {
+	const void* lock; // NULL이면 빈 칸
+	long long spins;
+	long long failed_cas;
+	long long acquisitions;
+	long long reacquisitions;
+	long long sleeps;
+	long long try_failures; // trylock/lock_timeout이 락을 얻지 못하고 돌아간 횟수 (TOLock은 큐를 포기한 횟수)
+} LockStats;
+
+// 스레드별 표 (그 스레드만 수정하고, 출력은 모든 스레드가 끝난 뒤에 한다)
+typedef struct ThreadStats {
+	alignas(CACHE_LINE) LockStats* entries;
+	int capacity; // 2의 거듭제곱
+	int used;
+	int tid;
+} ThreadStats;
+
+typedef struct LockOwner {
+	_Atomic(const void*) lock;
+	atomic_int tid;
+} LockOwner;
+
+typedef struct LockName {
+	const void* lock;
+	const char* name;
+} LockName;
+
+ThreadStats* stats_slots[STATS_MAX_THREADS];
+atomic_int stats_slot_count;
+atomic_int stats_generation; // stats_reset()마다 증가 (이전 테스트의 스레드별 포인터를 무효화)
+LockOwner stats_owners[STATS_OWNER_SLOTS];
+LockName stats_names[STATS_MAX_NAMES];
+int stats_name_count;
+_Thread_local ThreadStats* stats_local;
+_Thread_local int stats_local_generation;
+
+size_t stats_hash(const void* lock) {
+	size_t h = (size_t)lock / sizeof(int);
+	return h ^ (h >> 7) ^ (h >> 15);
+}
+
+LockStats* stats_alloc_entries(int capacity) {
+	LockStats* entries = (LockStats*)_aligned_malloc(sizeof(LockStats) * capacity, CACHE_LINE);
+	for (int i = 0; i < capacity; ++i) {
+		entries[i].lock = NULL;
+	}
+	return entries;
+}
+
+ThreadStats* thread_stats(void) {
+	int generation = atomic_load_explicit(&stats_generation, memory_order_relaxed);
+	if (stats_local == NULL || stats_local_generation != generation) {
+		int index = atomic_fetch_add(&stats_slot_count, 1);
+		if (index >= STATS_MAX_THREADS) {
+			return NULL;
+		}
+		ThreadStats* stats = (ThreadStats*)_aligned_malloc(sizeof(ThreadStats), CACHE_LINE);
+		stats->capacity = 16;
+		stats->entries = stats_alloc_entries(stats->capacity);
+		stats->used = 0;
+		stats->tid = index + 1; // 0은 소유자 없음
+		stats_slots[index] = stats;
+		stats_local = stats;
+		stats_local_generation = generation;
+	}
+	return stats_local;
+}
+
+LockStats* stats_find(ThreadStats* stats, const void* lock) {
+	size_t mask = (size_t)stats->capacity - 1;
+	for (size_t i = stats_hash(lock) & mask;; i = (i + 1) & mask) {
+		LockStats* entry = &stats->entries[i];
+		if (entry->lock == lock || entry->lock == NULL) {
+			return entry;
+		}
+	}
+}
+
+// 이 스레드의 표에서 lock의 칸을 찾는다 (없으면 만든다)
+LockStats* lock_stats(const void* lock) {
+	ThreadStats* stats = thread_stats();
+	if (stats == NULL) {
+		return NULL;
+	}
+	LockStats* entry = stats_find(stats, lock);
+	if (entry->lock != NULL) {
+		return entry;
+	}
+	if ((stats->used + 1) * 4 > stats->capacity * 3) {
+		// 3/4 이상 차면 두 배로 늘린다
+		LockStats* old = stats->entries;
+		int old_capacity = stats->capacity;
+		stats->capacity *= 2;
+		stats->entries = stats_alloc_entries(stats->capacity);
+		for (int i = 0; i < old_capacity; ++i) {
+			if (old[i].lock != NULL) {
+				*stats_find(stats, old[i].lock) = old[i];
+			}
+		}
+		_aligned_free(old);
+		entry = stats_find(stats, lock);
+	}
+	entry->lock = lock;
+	entry->spins = 0;
+	entry->failed_cas = 0;
+	entry->acquisitions = 0;
+	entry->reacquisitions = 0;
+	entry->sleeps = 0;
+	entry->try_failures = 0;
+	++stats->used;
+	return entry;
+}
+
+// lock의 마지막 소유 스레드를 tid로 바꾸고 이전 소유 스레드를 반환한다
+int stats_swap_owner(const void* lock, int tid) {
+	for (size_t n = 0, i = stats_hash(lock) % STATS_OWNER_SLOTS; n < STATS_OWNER_SLOTS; ++n, i = (i + 1) % STATS_OWNER_SLOTS) {
+		LockOwner* owner = &stats_owners[i];
+		const void* current = atomic_load_explicit(&owner->lock, memory_order_acquire);
+		if (current == NULL) {
+			const void* expected = NULL;
+			if (atomic_compare_exchange_strong(&owner->lock, &expected, lock)) {
+				current = lock;
+			}
+			else {
+				current = expected;
+			}
+		}
+		if (current == lock) {
+			return atomic_exchange_explicit(&owner->tid, tid, memory_order_relaxed);
+		}
+	}
+	return 0; // 표가 가득 찼으면 stickiness를 세지 않는다
+}
+
+void stats_acquired(const void* lock) {
+	LockStats* entry = lock_stats(lock);
+	if (entry == NULL) {
+		return;
+	}
+	++entry->acquisitions;
+	// 같은 락을 바로 전에 가졌던 스레드가 자신이면 다시 얻은 것이다
+	if (stats_swap_owner(lock, stats_local->tid) == stats_local->tid) {
+		++entry->reacquisitions;
+	}
+}
 
-typedef struct AtomicLock {
-	atomic_int state;
-} AtomicLock;
+void stats_spin(const void* lock) {
+	LockStats* entry = lock_stats(lock);
+	if (entry != NULL) {
+		++entry->spins;
+	}
+}
+
+void stats_failed_cas(const void* lock) {
+	LockStats* entry = lock_stats(lock);
+	if (entry != NULL) {
+		++entry->failed_cas;
+	}
+}
+
+void stats_sleep(const void* lock) {
+	LockStats* entry = lock_stats(lock);
+	if (entry != NULL) {
+		++entry->sleeps;
+	}
+}
+
+void stats_try_failed(const void* lock) {
+	LockStats* entry = lock_stats(lock);
+	if (entry != NULL) {
+		++entry->try_failures;
+	}
+}
+
+// 출력할 때 사용할 락 이름 (스레드를 만들기 전에 등록한다. stats_reset()에서 지워진다)
+void stats_name(const void* lock, const char* name) {
+	if (stats_name_count < STATS_MAX_NAMES) {
+		stats_names[stats_name_count].lock = lock;
+		stats_names[stats_name_count].name = name;
+		++stats_name_count;
+	}
+}
+
+// 모든 스레드가 끝난 뒤에 호출한다 (테스트 사이에서 카운터를 비운다)
+void stats_reset(void) {
+	int count = atomic_load(&stats_slot_count);
+	for (int i = 0; i < count && i < STATS_MAX_THREADS; ++i) {
+		_aligned_free(stats_slots[i]->entries);
+		_aligned_free(stats_slots[i]);
+		stats_slots[i] = NULL;
+	}
+	atomic_store(&stats_slot_count, 0);
+	for (int i = 0; i < STATS_OWNER_SLOTS; ++i) {
+		atomic_store(&stats_owners[i].lock, NULL);
+		atomic_store(&stats_owners[i].tid, 0);
+	}
+	stats_name_count = 0;
+	atomic_fetch_add(&stats_generation, 1);
+}
+
+void stats_add(LockStats* to, const LockStats* from) {
+	to->spins += from->spins;
+	to->failed_cas += from->failed_cas;
+	to->acquisitions += from->acquisitions;
+	to->reacquisitions += from->reacquisitions;
+	to->sleeps += from->sleeps;
+	to->try_failures += from->try_failures;
+}
+
+void stats_print_line(const char* name, const char* lock_name, const LockStats* total) {
+	printf("%s Stats%s: acquisitions %lld, spins %lld, failed CAS %lld, reacquisitions %lld (%.1f%%), sleeps %lld, failed tries %lld\n", name, lock_name,
+		total->acquisitions, total->spins, total->failed_cas, total->reacquisitions,
+		total->acquisitions > 0 ? 100.0 * total->reacquisitions / total->acquisitions : 0.0, total->sleeps, total->try_failures);
+}
+
+int stats_compare_acquisitions(const void* a, const void* b) {
+	long long x = ((const LockStats*)a)->acquisitions;
+	long long y = ((const LockStats*)b)->acquisitions;
+	return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+// 모든 스레드의 표를 락별로 합쳐서 출력하고 카운터를 비운다
+void stats_print(const char* name) {
+	int count = atomic_load(&stats_slot_count);
+	if (count > STATS_MAX_THREADS) {
+		count = STATS_MAX_THREADS;
+	}
+
+	// 락별 합계 (스레드별 표와 같은 방식의 open addressing)
+	// 서로 다른 락은 많아야 모든 스레드 표의 칸 수의 합이므로, 그 두 배 이상으로 잡으면 표가 차지 않는다
+	int entry_num = 0;
+	for (int i = 0; i < count; ++i) {
+		entry_num += stats_slots[i]->used;
+	}
+	ThreadStats merged;
+	merged.capacity = 16;
+	merged.used = 0;
+	while (merged.capacity < entry_num * 2) {
+		merged.capacity *= 2;
+	}
+	merged.entries = stats_alloc_entries(merged.capacity);
+	for (int i = 0; i < count; ++i) {
+		for (int k = 0; k < stats_slots[i]->capacity; ++k) {
+			LockStats* from = &stats_slots[i]->entries[k];
+			if (from->lock == NULL) {
+				continue;
+			}
+			LockStats* to = stats_find(&merged, from->lock);
+			if (to->lock == NULL) {
+				*to = *from;
+				++merged.used;
+			}
+			else {
+				stats_add(to, from);
+			}
+		}
+	}
+
+	// 획득 횟수가 많은 락부터 출력한다
+	LockStats* locks = (LockStats*)malloc(sizeof(LockStats) * (merged.used > 0 ? merged.used : 1));
+	int lock_num = 0;
+	for (int k = 0; k < merged.capacity; ++k) {
+		if (merged.entries[k].lock != NULL) {
+			locks[lock_num++] = merged.entries[k];
+		}
+	}
+	qsort(locks, lock_num, sizeof(LockStats), stats_compare_acquisitions);
+
+	LockStats rest = { NULL, 0, 0, 0, 0, 0, 0 };
+	char lock_name[64];
+	for (int k = 0; k < lock_num; ++k) {
+		if (k >= STATS_PRINT_LOCKS) {
+			stats_add(&rest, &locks[k]);
+			continue;
+		}
+		const char* registered = NULL;
+		for (int n = 0; n < stats_name_count; ++n) {
+			if (stats_names[n].lock == locks[k].lock) {
+				registered = stats_names[n].name;
+			}
+		}
+		if (lock_num == 1 && registered == NULL) {
+			lock_name[0] = '\0';
+		}
+		else if (registered != NULL) {
+			snprintf(lock_name, sizeof(lock_name), " [%s]", registered);
+		}
+		else {
+			snprintf(lock_name, sizeof(lock_name), " [lock %d of %d]", k + 1, lock_num);
+		}
+		stats_print_line(name, lock_name, &locks[k]);
+	}
+	if (lock_num == 0) {
+		stats_print_line(name, "", &rest);
+	}
+	else if (lock_num > STATS_PRINT_LOCKS) {
+		snprintf(lock_name, sizeof(lock_name), " [other %d locks]", lock_num - STATS_PRINT_LOCKS);
+		stats_print_line(name, lock_name, &rest);
+	}
+
+	free(locks);
+	_aligned_free(merged.entries);
+	stats_reset();
+}
+
+#define STATS_ACQUIRED(lock) stats_acquired(lock)
+#define STATS_SPIN(lock) stats_spin(lock)
+#define STATS_FAILED_CAS(lock) stats_failed_cas(lock)
+#define STATS_SLEEP(lock) stats_sleep(lock)
+#define STATS_TRY_FAILED(lock) stats_try_failed(lock)
+#define STATS_NAME(lock, name) stats_name(lock, name)
+#define STATS_PRINT(name) stats_print(name)
+#define STATS_RESET() stats_reset()
+#else
+#define STATS_ACQUIRED(lock) ((void)0)
+#define STATS_SPIN(lock) ((void)0)
+#define STATS_FAILED_CAS(lock) ((void)0)
+#define STATS_SLEEP(lock) ((void)0)
+#define STATS_TRY_FAILED(lock) ((void)0)
+#define STATS_NAME(lock, name) ((void)0)
+#define STATS_PRINT(name) ((void)0)
+#define STATS_RESET() ((void)0)
+#endif
+
+// 락 구현 (위의 TRACE_*/STATS_* 매크로를 사용하므로 그 뒤에서 포함한다)
+#include "Locks.h"
+#include "Barriers.h"
 
 typedef struct NoAtomicLock {
     int state;
@@ -54,25 +573,10 @@ NoAtomicThreadData init_no_atomic_thread_data(NoAtomicLock* l, int start, int en
 	return d;
 }
 
-// Initialize the TASLock
-void init_atomic_lock(AtomicLock* lock) {
-	atomic_init(&lock->state, 0);
-}
-
 void init_no_atomic_lock(NoAtomicLock* lock) {
     lock->state = 0;
 }
 
-// Acquire the TASLock using atomic_fetch_and_add
-
-// 이 코드를 사용하면 데드락 문제와 값이 덮어쓰기되는 문제가 발생하지 않음
-// atomic_fetch_add : 스레드끼리 값을 공유하면서 증가시키는 함수일 뿐이다
-// 이때 값은 fetch와 add할 때 각각은 원자성을 보장하나 fetch와 add을 동시에 할 때는 원자성을 보장하지 않는다
-// atomic_compare_exchange_waek : 이 함수는 변수의 현재 값과 기대 값(expected value)을 비교합니다. 
-// 현재 값이 기대 값과 같으면 새 값(desired value)으로 교환하고, 그렇지 않으면 실패를 반환합니다. 
-// 이 함수는 실패할 가능성이 있기 때문에 반복적인 시도에 적합합니다
-// atomic_exchange : 변수의 값을 새 값으로 설정하고 이전 값을 원자적으로 반환(단일 교환 연산이 필요한 경우 사용한다)
-
 void no_atomic_lock(NoAtomicLock* lock) {
     while (true) {
 		if (lock->state == 0) {
@@ -82,55 +586,6 @@ void no_atomic_lock(NoAtomicLock* lock) {
 	}
 }
 
-void tas_lock(AtomicLock* lock) {
-	int expected = 0;
-	while (true) {
-		expected = 0; // 기대 값을 초기화
-		if (atomic_compare_exchange_weak(&lock->state, &expected, 1)) {
-			break; // 락 획득 성공
-		}
-	}
-}
-
-void ttas_lock(AtomicLock* lock) {
-	while (true) {
-		// 첫 번째 테스트: 상태가 0인지 확인
-		if (atomic_load(&lock->state) == 0) {
-			// 두 번째 테스트: 비교 후 교환 시도
-			int expected = 0;
-			if (atomic_compare_exchange_weak(&lock->state, &expected, 1)) {
-				break; // 락 획득 성공
-			}
-		}
-		// 락 획득 실패 시 반복 시도
-	}
-}
-
-void back_off_lock(AtomicLock* lock) {
-    int backoff_time = 20; // 초기 백오프 시간 (밀리초 단위)
-	while (true) {
-		// 첫 번째 테스트: 상태가 0인지 확인
-		if (atomic_load(&lock->state) == 0) {
-			// 두 번째 테스트: 비교 후 교환 시도
-			int expected = 0;
-			if (atomic_compare_exchange_weak(&lock->state, &expected, 1)) {
-				break; // 락 획득 성공
-			}
-		}
-		// 락 획득 실패 후 일정 시간 대기 (지수 백오프)
-		Sleep(backoff_time);
-		backoff_time *= 2; // 백오프 시간 두 배로 증가
-		if (backoff_time > 1000) { // 최대 백오프 시간 제한 (1초)
-			backoff_time = 1000;
-		}
-	}
-}
-
-// Release the TASLock
-void atomic_unlock(AtomicLock* lock) {
-	atomic_store(&lock->state, 0);
-}
-
 void no_atomic_unlock(NoAtomicLock* lock) {
     lock->state = 0;
 }
@@ -545,6 +1000,7 @@ void tas_test() {
 	printf("%d threads\n", TWO);
 	printf("TASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TASLock Sum: %llu\n", sum);
+	STATS_PRINT("TASLock");
 
 	// 4개의 스레드를 사용한 TASLock 테스트
 	init_atomic_lock(&lock);
@@ -571,6 +1027,7 @@ void tas_test() {
 	printf("%d threads\n", FOUR);
 	printf("TASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TASLock Sum: %llu\n", sum);
+	STATS_PRINT("TASLock");
 
 	// 8개의 스레드를 사용한 TASLock 테스트
 	init_atomic_lock(&lock);
@@ -597,6 +1054,7 @@ void tas_test() {
 	printf("%d threads\n", EIGHT);
 	printf("TASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TASLock Sum: %llu\n", sum);
+	STATS_PRINT("TASLock");
 
 	// 16개의 스레드를 사용한 TASLock 테스트
 	init_atomic_lock(&lock);
@@ -623,6 +1081,7 @@ void tas_test() {
 	printf("%d threads\n", SIXTEEN);
 	printf("TASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TASLock Sum: %llu\n", sum);
+	STATS_PRINT("TASLock");
 
 	// 32개의 스레드를 사용한 TASLock 테스트
 	init_atomic_lock(&lock);
@@ -649,6 +1108,7 @@ void tas_test() {
 	printf("%d threads\n", THIRTYTWO);
 	printf("TASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TASLock Sum: %llu\n", sum);
+	STATS_PRINT("TASLock");
 
 	// 64개의 스레드를 사용한 TASLock 테스트
 	init_atomic_lock(&lock);
@@ -675,6 +1135,7 @@ void tas_test() {
 	printf("%d threads\n", SIXTYFOUR);
 	printf("TASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TASLock Sum: %llu\n", sum);
+	STATS_PRINT("TASLock");
 }
 
 void ttas_test() {
@@ -708,6 +1169,7 @@ void ttas_test() {
 	printf("%d threads\n", TWO);
 	printf("TTASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TTASLock Sum: %llu\n", sum);
+	STATS_PRINT("TTASLock");
 
 	// 4개의 스레드를 사용한 TTASLock 테스트
 	init_atomic_lock(&lock);
@@ -734,6 +1196,7 @@ void ttas_test() {
 	printf("%d threads\n", FOUR);
 	printf("TTASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TTASLock Sum: %llu\n", sum);
+	STATS_PRINT("TTASLock");
 
 	// 8개의 스레드를 사용한 TASLock 테스트
 	init_atomic_lock(&lock);
@@ -760,6 +1223,7 @@ void ttas_test() {
 	printf("%d threads\n", EIGHT);
 	printf("TTASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TTASLock Sum: %llu\n", sum);
+	STATS_PRINT("TTASLock");
 
 	// 16개의 스레드를 사용한 TTASLock 테스트
 	init_atomic_lock(&lock);
@@ -786,6 +1250,7 @@ void ttas_test() {
 	printf("%d threads\n", SIXTEEN);
 	printf("TTASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TTASLock Sum: %llu\n", sum);
+	STATS_PRINT("TTASLock");
 
 	// 32개의 스레드를 사용한 TTASLock 테스트
 	init_atomic_lock(&lock);
@@ -812,6 +1277,7 @@ void ttas_test() {
 	printf("%d threads\n", THIRTYTWO);
 	printf("TTASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TTASLock Sum: %llu\n", sum);
+	STATS_PRINT("TTASLock");
 
 	// 64개의 스레드를 사용한 TTASLock 테스트
 	init_atomic_lock(&lock);
@@ -838,6 +1304,7 @@ void ttas_test() {
 	printf("%d threads\n", SIXTYFOUR);
 	printf("TTASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("TTASLock Sum: %llu\n", sum);
+	STATS_PRINT("TTASLock");
 }
 
 void back_off_test() {
@@ -871,6 +1338,7 @@ void back_off_test() {
 	printf("%d threads\n", TWO);
 	printf("Backoff Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("Backoff Sum: %llu\n", sum);
+	STATS_PRINT("Backoff");
 
 	// 4개의 스레드를 사용한 Backoff 테스트
 	init_atomic_lock(&lock);
@@ -897,6 +1365,7 @@ void back_off_test() {
 	printf("%d threads\n", FOUR);
 	printf("Backoff Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("Backoff Sum: %llu\n", sum);
+	STATS_PRINT("Backoff");
 
 	// 8개의 스레드를 사용한 Backoff 테스트
 	init_atomic_lock(&lock);
@@ -923,6 +1392,7 @@ void back_off_test() {
 	printf("%d threads\n", EIGHT);
 	printf("Backoff Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("Backoff Sum: %llu\n", sum);
+	STATS_PRINT("Backoff");
 
 	// 16개의 스레드를 사용한 Backoff 테스트
 	init_atomic_lock(&lock);
@@ -949,6 +1419,7 @@ void back_off_test() {
 	printf("%d threads\n", SIXTEEN);
 	printf("Backoff Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("Backoff Sum: %llu\n", sum);
+	STATS_PRINT("Backoff");
 
 	// 32개의 스레드를 사용한 Backoff 테스트
 	init_atomic_lock(&lock);
@@ -975,6 +1446,7 @@ void back_off_test() {
 	printf("%d threads\n", THIRTYTWO);
 	printf("Backoff Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("Backoff Sum: %llu\n", sum);
+	STATS_PRINT("Backoff");
 
 	// 64개의 스레드를 사용한 Backoff 테스트
 	init_atomic_lock(&lock);
@@ -1001,31 +1473,3134 @@ void back_off_test() {
 	printf("%d threads\n", SIXTYFOUR);
 	printf("Backoff Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
 	printf("Backoff Sum: %llu\n", sum);
+	STATS_PRINT("Backoff");
 }
 
-int main(void) {
+// n개의 스레드 중 i번째 스레드가 맡을 구간 (기존 테스트와 같은 방식으로 나눈다)
+int range_start(int i, int n) {
+	if (i == 0) {
+		return MIN_NUM;
+	}
+	return MIN_NUM + (MAX_NUM - MIN_NUM) / n * i + 1;
+}
+
+int range_end(int i, int n) {
+	if (i == n - 1) {
+		return MAX_NUM;
+	}
+	return MIN_NUM + (MAX_NUM - MIN_NUM) / n * (i + 1);
+}
+
+typedef struct RWThreadData {
+	RWLock* lock;
+	int start;
+	int end;
+	int write_percent;
+	unsigned long long read_sum; // 읽은 값을 누적 (읽기가 최적화로 사라지지 않도록)
+	long long reads; // rw_snapshot_add에서만 사용
+	long long torn;  // rw_snapshot_add에서 일관되지 않은 스냅샷을 읽은 횟수 (항상 0이어야 한다)
+} RWThreadData;
+
+typedef struct BigReaderThreadData {
+	BigReaderLock* lock;
+	int id;
+	int start;
+	int end;
+	int write_percent;
+	unsigned long long read_sum;
+} BigReaderThreadData;
+
+RWThreadData init_rw_thread_data(RWLock* l, int start, int end, int write_percent) {
+	RWThreadData d;
+	d.lock = l;
+	d.start = start;
+	d.end = end;
+	d.write_percent = write_percent;
+	d.read_sum = 0;
+	d.reads = 0;
+	d.torn = 0;
+
+	return d;
+}
+
+BigReaderThreadData init_big_reader_thread_data(BigReaderLock* l, int id, int start, int end, int write_percent) {
+	BigReaderThreadData d;
+	d.lock = l;
+	d.id = id;
+	d.start = start;
+	d.end = end;
+	d.write_percent = write_percent;
+	d.read_sum = 0;
+
+	return d;
+}
+
+// 읽기 위주 작업: write_percent%의 연산은 sum에 값을 더하고, 나머지는 sum을 읽기만 한다
+int rw_add(void* arg) {
+	RWThreadData* data = (RWThreadData*)arg;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		if (i % 100 < data->write_percent) {
+			rw_write_lock(data->lock);
+			sum += i;
+			rw_write_unlock(data->lock);
+		}
+		else {
+			rw_read_lock(data->lock);
+			data->read_sum += sum;
+			rw_read_unlock(data->lock);
+		}
+	}
+
+	return 0;
+}
+
+int rw_pref_add(void* arg) {
+	RWThreadData* data = (RWThreadData*)arg;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		if (i % 100 < data->write_percent) {
+			rw_pref_write_lock(data->lock);
+			sum += i;
+			rw_write_unlock(data->lock);
+		}
+		else {
+			rw_pref_read_lock(data->lock);
+			data->read_sum += sum;
+			rw_read_unlock(data->lock);
+		}
+	}
+
+	return 0;
+}
+
+int big_reader_add(void* arg) {
+	BigReaderThreadData* data = (BigReaderThreadData*)arg;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		if (i % 100 < data->write_percent) {
+			br_write_lock(data->lock);
+			sum += i;
+			br_write_unlock(data->lock);
+		}
+		else {
+			br_read_lock(data->lock, data->id);
+			data->read_sum += sum;
+			br_read_unlock(data->lock, data->id);
+		}
+	}
+
+	return 0;
+}
+
+// RWLock을 사용하는 읽기 위주 테스트 (rw_add, rw_pref_add)
+void rw_test(int (*func)(void*), const char* name, int write_percent) {
 	clock_t start;
 	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	RWLock lock;
+	RWThreadData data[SIXTYFOUR];
 
-	start = clock();
-	for (int i = MIN_NUM; i <= MAX_NUM; ++i) {
-		sum += i;
+	for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+		int n = THREAD_COUNTS[t];
+		init_rw_lock(&lock);
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_rw_thread_data(&lock, range_start(i, n), range_end(i, n), write_percent);
+		}
+
+		sum = 0;
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], func, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		printf("%d threads\n", n);
+		printf("%s Time: %f\n", name, (double)(end - start) / CLOCKS_PER_SEC);
+		printf("%s Sum: %llu\n", name, sum);
+		STATS_PRINT(name);
 	}
-	end = clock();
+}
 
-	printf("Single thread time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
-	printf("Sum: %llu\n", sum);
+void big_reader_test(int write_percent) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	BigReaderLock lock;
+	BigReaderThreadData data[SIXTYFOUR];
 
-    printf("\n===NoLock test===\n");
-    no_lock_test();
-    printf("\n===SpinLock test===\n");
-    spin_lock_test();
-	printf("\n===TASLock test===\n");
-	tas_test();
-	printf("\n===TTASLock test===\n");
-	ttas_test();
-	printf("\n===Back-off test===\n");
-	back_off_test();
+	for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+		int n = THREAD_COUNTS[t];
+		init_big_reader_lock(&lock);
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_big_reader_thread_data(&lock, i, range_start(i, n), range_end(i, n), write_percent);
+		}
+
+		sum = 0;
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], big_reader_add, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		printf("%d threads\n", n);
+		printf("BigReaderLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
+		printf("BigReaderLock Sum: %llu\n", sum);
+		STATS_PRINT("BigReaderLock");
+	}
+}
+
+// Sequence Lock 테스트 (SeqLock은 Locks.h)
+// 쓰기 스레드끼리의 상호 배제는 기존 락(ttas_lock)으로 한다
+// 읽기 스레드가 한 번에 일관되게 읽어야 하는 여러 워드의 상태
+// seqlock에서는 쓰는 도중에도 읽을 수 있으므로 각 워드는 relaxed 원자 연산으로 접근한다
+typedef struct SharedState {
+	atomic_ullong sum;
+	atomic_ullong count;
+	atomic_ullong timestamp;
+} SharedState;
+
+SharedState shared_state;
+
+typedef struct SeqThreadData {
+	SeqLock* seq;
+	AtomicLock* writer;
+	int start;
+	int end;
+	int write_percent;
+	unsigned long long read_sum;
+	long long reads;
+	long long retries; // 쓰기와 겹쳐서 다시 읽은 횟수
+	long long torn;    // 일관되지 않은 스냅샷을 사용한 횟수 (항상 0이어야 한다)
+} SeqThreadData;
+
+SeqThreadData init_seq_thread_data(SeqLock* seq, AtomicLock* writer, int start, int end, int write_percent) {
+	SeqThreadData d;
+	d.seq = seq;
+	d.writer = writer;
+	d.start = start;
+	d.end = end;
+	d.write_percent = write_percent;
+	d.read_sum = 0;
+	d.reads = 0;
+	d.retries = 0;
+	d.torn = 0;
+
+	return d;
+}
+
+void init_shared_state(SharedState* state) {
+	atomic_init(&state->sum, 0);
+	atomic_init(&state->count, 0);
+	atomic_init(&state->timestamp, 0);
+}
+
+// 쓰기: sum에 값을 더하고 count와 timestamp를 함께 갱신한다 (락을 잡은 상태에서 호출)
+void shared_state_write(SharedState* state, int value) {
+	atomic_store_explicit(&state->sum, atomic_load_explicit(&state->sum, memory_order_relaxed) + value, memory_order_relaxed);
+	atomic_store_explicit(&state->count, atomic_load_explicit(&state->count, memory_order_relaxed) + 1, memory_order_relaxed);
+	atomic_store_explicit(&state->timestamp, (unsigned long long)clock(), memory_order_relaxed);
+}
+
+// 일관된 스냅샷이면 MIN_NUM * count <= sum <= MAX_NUM * count 가 성립한다
+bool snapshot_consistent(unsigned long long snap_sum, unsigned long long snap_count) {
+	return snap_sum >= snap_count * MIN_NUM && snap_sum <= snap_count * MAX_NUM;
+}
+
+int seq_lock_add(void* arg) {
+	SeqThreadData* data = (SeqThreadData*)arg;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		if (i % 100 < data->write_percent) {
+			ttas_lock(data->writer);
+			seq_write_begin(data->seq);
+			shared_state_write(&shared_state, i);
+			seq_write_end(data->seq);
+			atomic_unlock(data->writer);
+		}
+		else {
+			unsigned long long snap_sum;
+			unsigned long long snap_count;
+			unsigned long long snap_time;
+			unsigned int seq;
+			while (true) {
+				seq = seq_read_begin(data->seq);
+				snap_sum = atomic_load_explicit(&shared_state.sum, memory_order_relaxed);
+				snap_count = atomic_load_explicit(&shared_state.count, memory_order_relaxed);
+				snap_time = atomic_load_explicit(&shared_state.timestamp, memory_order_relaxed);
+				if (!seq_read_retry(data->seq, seq)) {
+					break; // 일관된 스냅샷
+				}
+				++data->retries;
+			}
+			if (!snapshot_consistent(snap_sum, snap_count)) {
+				++data->torn;
+			}
+			data->read_sum += snap_sum + snap_time;
+			++data->reads;
+		}
+	}
+
+	return 0;
+}
+
+// 비교용: 같은 상태를 RWLock으로 보호한다 (seq_lock_add와 같은 필드를 읽고 같은 검사를 한다)
+int rw_snapshot_add(void* arg) {
+	RWThreadData* data = (RWThreadData*)arg;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		if (i % 100 < data->write_percent) {
+			rw_write_lock(data->lock);
+			shared_state_write(&shared_state, i);
+			rw_write_unlock(data->lock);
+		}
+		else {
+			rw_read_lock(data->lock);
+			unsigned long long snap_sum = atomic_load_explicit(&shared_state.sum, memory_order_relaxed);
+			unsigned long long snap_count = atomic_load_explicit(&shared_state.count, memory_order_relaxed);
+			unsigned long long snap_time = atomic_load_explicit(&shared_state.timestamp, memory_order_relaxed);
+			rw_read_unlock(data->lock);
+			if (!snapshot_consistent(snap_sum, snap_count)) {
+				++data->torn;
+			}
+			data->read_sum += snap_sum + snap_time;
+			++data->reads;
+		}
+	}
+
+	return 0;
+}
+
+void seq_lock_test(int write_percent) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	SeqLock seq;
+	AtomicLock writer;
+	SeqThreadData data[SIXTYFOUR];
+
+	for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+		int n = THREAD_COUNTS[t];
+		init_seq_lock(&seq);
+		init_atomic_lock(&writer);
+		init_shared_state(&shared_state);
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_seq_thread_data(&seq, &writer, range_start(i, n), range_end(i, n), write_percent);
+		}
+
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], seq_lock_add, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		long long reads = 0;
+		long long retries = 0;
+		long long torn = 0;
+		for (int i = 0; i < n; ++i) {
+			reads += data[i].reads;
+			retries += data[i].retries;
+			torn += data[i].torn;
+		}
+
+		printf("%d threads\n", n);
+		printf("SeqLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
+		printf("SeqLock Sum: %llu\n", atomic_load(&shared_state.sum));
+		STATS_PRINT("SeqLock");
+		printf("SeqLock Reads: %lld, Retries: %lld, Torn: %lld\n", reads, retries, torn);
+	}
+}
+
+void rw_snapshot_test(int write_percent) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	RWLock lock;
+	RWThreadData data[SIXTYFOUR];
+
+	for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+		int n = THREAD_COUNTS[t];
+		init_rw_lock(&lock);
+		init_shared_state(&shared_state);
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_rw_thread_data(&lock, range_start(i, n), range_end(i, n), write_percent);
+		}
+
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], rw_snapshot_add, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		long long reads = 0;
+		long long torn = 0;
+		for (int i = 0; i < n; ++i) {
+			reads += data[i].reads;
+			torn += data[i].torn;
+		}
+
+		printf("%d threads\n", n);
+		printf("RWLock snapshot Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
+		printf("RWLock snapshot Sum: %llu\n", atomic_load(&shared_state.sum));
+		STATS_PRINT("RWLock snapshot");
+		printf("RWLock snapshot Reads: %lld, Torn: %lld\n", reads, torn);
+	}
+}
+
+typedef struct TOThreadData {
+	TOLock* lock;
+	TOThreadNode node;
+	int start;
+	int end;
+	long long failures;
+} TOThreadData;
+
+TOThreadData init_to_thread_data(TOLock* l, int start, int end) {
+	TOThreadData d;
+	d.lock = l;
+	d.node.my_node = NULL;
+	d.node.free_list = NULL;
+	d.start = start;
+	d.end = end;
+	d.failures = 0;
+
+	return d;
+}
+
+// 락을 얻지 못하면 기다리지 않고 다른 일(값을 로컬에 모아 두기)을 한다
+// 모아 둔 값은 다음에 락을 얻었을 때 한 번에 더하고, 마지막에 남은 값은 블로킹 락으로 더한다
+typedef struct TryThreadData {
+	AtomicLock* lock;
+	int start;
+	int end;
+	long long failures;
+} TryThreadData;
+
+TryThreadData init_try_thread_data(AtomicLock* l, int start, int end) {
+	TryThreadData d;
+	d.lock = l;
+	d.start = start;
+	d.end = end;
+	d.failures = 0;
+
+	return d;
+}
+
+// 락마다 전용 작업 함수를 만든다 (락 함수가 루프 안으로 인라인된다)
+// prefix_try_add : trylock_fn으로 시도한다
+// prefix_timeout_add : lock_timeout_fn으로 TRY_TIMEOUT만큼 기다려 본다
+#define DEFINE_TRY_WORKERS(prefix, lock_fn, trylock_fn, lock_timeout_fn) \
+	int prefix##_try_add(void* arg) { \
+		TryThreadData* data = (TryThreadData*)arg; \
+		unsigned long long pending = 0; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			pending += i; \
+			if (trylock_fn(data->lock)) { \
+				sum += pending; \
+				atomic_unlock(data->lock); \
+				pending = 0; \
+			} \
+			else { \
+				++data->failures; \
+			} \
+		} \
+		lock_fn(data->lock); \
+		sum += pending; \
+		atomic_unlock(data->lock); \
+		return 0; \
+	} \
+	int prefix##_timeout_add(void* arg) { \
+		TryThreadData* data = (TryThreadData*)arg; \
+		unsigned long long pending = 0; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			pending += i; \
+			if (lock_timeout_fn(data->lock, clock() + TRY_TIMEOUT)) { \
+				sum += pending; \
+				atomic_unlock(data->lock); \
+				pending = 0; \
+			} \
+			else { \
+				++data->failures; \
+			} \
+		} \
+		lock_fn(data->lock); \
+		sum += pending; \
+		atomic_unlock(data->lock); \
+		return 0; \
+	}
+
+DEFINE_TRY_WORKERS(tas, tas_lock, tas_trylock, tas_lock_timeout)
+DEFINE_TRY_WORKERS(ttas, ttas_lock, ttas_trylock, ttas_lock_timeout)
+DEFINE_TRY_WORKERS(back_off, back_off_lock, back_off_trylock, back_off_lock_timeout)
+
+int to_try_add(void* arg) {
+	TOThreadData* data = (TOThreadData*)arg;
+	unsigned long long pending = 0;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		pending += i;
+		if (to_trylock(data->lock, &data->node)) {
+			sum += pending;
+			to_unlock(data->lock, &data->node);
+			pending = 0;
+		}
+		else {
+			++data->failures;
+		}
+	}
+	to_lock(data->lock, &data->node);
+	sum += pending;
+	to_unlock(data->lock, &data->node);
+
+	return 0;
+}
+
+int to_timeout_add(void* arg) {
+	TOThreadData* data = (TOThreadData*)arg;
+	unsigned long long pending = 0;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		pending += i;
+		if (to_lock_timeout(data->lock, &data->node, clock() + TRY_TIMEOUT)) {
+			sum += pending;
+			to_unlock(data->lock, &data->node);
+			pending = 0;
+		}
+		else {
+			++data->failures;
+		}
+	}
+	to_lock(data->lock, &data->node);
+	sum += pending;
+	to_unlock(data->lock, &data->node);
+
+	return 0;
+}
+
+// func : DEFINE_TRY_WORKERS가 만든 prefix_try_add 또는 prefix_timeout_add
+void try_test(int (*func)(void*), const char* name) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	AtomicLock lock;
+	TryThreadData data[SIXTYFOUR];
+
+	for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+		int n = THREAD_COUNTS[t];
+		init_atomic_lock(&lock);
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_try_thread_data(&lock, range_start(i, n), range_end(i, n));
+		}
+
+		sum = 0;
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], func, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		long long failures = 0;
+		for (int i = 0; i < n; ++i) {
+			failures += data[i].failures;
+		}
+
+		printf("%d threads\n", n);
+		printf("%s Time: %f\n", name, (double)(end - start) / CLOCKS_PER_SEC);
+		printf("%s Sum: %llu\n", name, sum);
+		STATS_PRINT(name);
+		printf("%s Failures: %lld\n", name, failures);
+	}
+}
+
+#define TO_ABORT_OPS (20000)  // 포기 경로 회귀 테스트에서 스레드마다 시도하는 횟수
+#define TO_ABORT_ROUNDS (10)  // 포기한 노드가 남는 모양은 실행마다 다르므로 여러 번 반복한다
+
+// trylock과 짧은 timeout을 섞어서 포기한 노드를 많이 만든다
+int to_mixed_add(void* arg) {
+	TOThreadData* data = (TOThreadData*)arg;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		bool acquired = i % 2 == 0 ? to_trylock(data->lock, &data->node) : to_lock_timeout(data->lock, &data->node, clock() + i % 5);
+		if (acquired) {
+			sum += i;
+			if (i % 64 == 0) {
+				thrd_yield(); // 락을 가진 채 양보해서 코어가 적어도 다른 스레드가 기다리다 포기하게 만든다
+			}
+			to_unlock(data->lock, &data->node);
+		}
+		else {
+			++data->failures;
+		}
+	}
+
+	return 0;
+}
+
+// 포기 경로 회귀 테스트
+// 경합 중에 trylock/timeout이 포기한 노드가 큐에 남아 있어도, 모든 스레드가 끝난 뒤 비어 있는 락에 대한 trylock은 성공해야 한다
+void to_abort_recovery_test(void) {
+	thrd_t threads[EIGHT];
+	TOLock lock;
+	TOThreadData data[EIGHT];
+	int n = EIGHT;
+
+	long long failures = 0;
+	int failed_rounds = 0;
+
+	for (int round = 0; round < TO_ABORT_ROUNDS; ++round) {
+		init_to_lock(&lock);
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_to_thread_data(&lock, i * TO_ABORT_OPS + 1, (i + 1) * TO_ABORT_OPS);
+		}
+
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], to_mixed_add, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				return;
+			}
+		}
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+			failures += data[i].failures;
+		}
+
+		// 모든 스레드가 끝났으므로 락은 비어 있다
+		TOThreadData main_data = init_to_thread_data(&lock, 0, 0);
+		if (to_trylock(&lock, &main_data.node)) {
+			to_unlock(&lock, &main_data.node);
+		}
+		else {
+			++failed_rounds;
+		}
+		destroy_to_lock(&lock);
+	}
+
+	printf("%d threads\n", n);
+	printf("TOLock abort Failures: %lld / %d\n", failures, TO_ABORT_ROUNDS * n * TO_ABORT_OPS);
+	if (failed_rounds == 0) {
+		printf("TOLock abort Trylock after contention: OK\n");
+	}
+	else {
+		printf("TOLock abort Trylock after contention: FAIL (%d of %d rounds)\n", failed_rounds, TO_ABORT_ROUNDS);
+	}
+}
+
+// func : to_try_add 또는 to_timeout_add
+void to_lock_test(int (*func)(void*), const char* name) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	TOLock lock;
+	TOThreadData data[SIXTYFOUR];
+
+	for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+		int n = THREAD_COUNTS[t];
+		init_to_lock(&lock);
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_to_thread_data(&lock, range_start(i, n), range_end(i, n));
+		}
+
+		sum = 0;
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], func, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		long long failures = 0;
+		for (int i = 0; i < n; ++i) {
+			failures += data[i].failures;
+		}
+		destroy_to_lock(&lock);
+
+		printf("%d threads\n", n);
+		printf("%s Time: %f\n", name, (double)(end - start) / CLOCKS_PER_SEC);
+		printf("%s Sum: %llu\n", name, sum);
+		STATS_PRINT(name);
+		printf("%s Failures: %lld\n", name, failures);
+	}
+}
+
+// 닫힌 식으로 계산한 MIN_NUM ~ MAX_NUM의 합 (결과 검증용)
+unsigned long long expected_sum(void) {
+	return ((unsigned long long)MIN_NUM + MAX_NUM) * (MAX_NUM - MIN_NUM + 1) / 2;
+}
+
+// Hazard Pointer
+// 스레드는 읽으려는 노드를 자신의 hazard 슬롯에 표시하고, 제거한 노드는 바로 해제하지 않고 retire 목록에 모아 둔다
+// retire 목록이 차면 모든 스레드의 hazard 슬롯에 없는 노드만 해제한다
+#define HP_PER_THREAD (2)
+#define HP_RETIRE_THRESHOLD (2 * HP_PER_THREAD * SIXTYFOUR)
+
+typedef struct HazardSlot {
+	_Atomic(void*) hp[HP_PER_THREAD];
+	char pad[CACHE_LINE - HP_PER_THREAD * sizeof(void*)];
+} HazardSlot;
+
+typedef struct RetireList {
+	void* nodes[HP_RETIRE_THRESHOLD];
+	int count;
+} RetireList;
+
+HazardSlot hazard_slots[SIXTYFOUR];
+
+void init_hazard_slots(void) {
+	for (int i = 0; i < SIXTYFOUR; ++i) {
+		for (int j = 0; j < HP_PER_THREAD; ++j) {
+			atomic_init(&hazard_slots[i].hp[j], NULL);
+		}
+	}
+}
+
+void hp_set(int id, int index, void* node) {
+	atomic_store(&hazard_slots[id].hp[index], node);
+}
+
+void hp_clear(int id) {
+	for (int j = 0; j < HP_PER_THREAD; ++j) {
+		atomic_store_explicit(&hazard_slots[id].hp[j], NULL, memory_order_release);
+	}
+}
+
+bool hp_is_protected(void* node) {
+	for (int i = 0; i < SIXTYFOUR; ++i) {
+		for (int j = 0; j < HP_PER_THREAD; ++j) {
+			if (atomic_load(&hazard_slots[i].hp[j]) == node) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void hp_retire(RetireList* list, void* node) {
+	list->nodes[list->count++] = node;
+	if (list->count < HP_RETIRE_THRESHOLD) {
+		return;
+	}
+	// hazard 슬롯 수보다 목록이 크므로 항상 하나 이상은 해제된다
+	int kept = 0;
+	for (int i = 0; i < list->count; ++i) {
+		if (hp_is_protected(list->nodes[i])) {
+			list->nodes[kept++] = list->nodes[i];
+		}
+		else {
+			free(list->nodes[i]);
+		}
+	}
+	list->count = kept;
+}
+
+// 모든 스레드가 끝난 뒤에 남은 노드를 해제한다
+void hp_drain(RetireList* list) {
+	for (int i = 0; i < list->count; ++i) {
+		free(list->nodes[i]);
+	}
+	list->count = 0;
+}
+
+// Treiber Stack (lock-free) 과 락으로 보호하는 스택/큐에서 사용하는 노드
+typedef struct ListNode {
+	int value;
+	struct ListNode* next;
+} ListNode;
+
+// Michael-Scott Queue (lock-free) 노드
+typedef struct QueueNode {
+	int value;
+	_Atomic(struct QueueNode*) next;
+} QueueNode;
+
+typedef struct LockFreeStack {
+	_Atomic(ListNode*) top;
+} LockFreeStack;
+
+// head와 tail은 서로 다른 스레드가 주로 수정하므로 다른 캐시 라인에 둔다
+typedef struct LockFreeQueue {
+	_Atomic(QueueNode*) head;
+	char pad[CACHE_LINE - sizeof(void*)];
+	_Atomic(QueueNode*) tail;
+} LockFreeQueue;
+
+typedef struct LockedStack {
+	AtomicLock lock;
+	ListNode* top;
+} LockedStack;
+
+typedef struct LockedQueue {
+	AtomicLock lock;
+	ListNode* head;
+	ListNode* tail;
+} LockedQueue;
+
+#define DS_LOCK_FREE_STACK (0)
+#define DS_LOCK_FREE_QUEUE (1)
+#define DS_LOCKED_STACK (2)
+#define DS_LOCKED_QUEUE (3)
+
+// ds는 LockFreeStack, LockFreeQueue, LockedStack, LockedQueue 중 하나
+typedef struct DSThreadData {
+	void* ds;
+	int id;
+	int start;
+	int end;
+	unsigned long long pop_sum;
+	RetireList retired;
+} DSThreadData;
+
+DSThreadData init_ds_thread_data(void* ds, int id, int start, int end) {
+	DSThreadData d;
+	d.ds = ds;
+	d.id = id;
+	d.start = start;
+	d.end = end;
+	d.pop_sum = 0;
+	d.retired.count = 0;
+
+	return d;
+}
+
+void init_lock_free_stack(LockFreeStack* stack) {
+	atomic_init(&stack->top, NULL);
+}
+
+void destroy_lock_free_stack(LockFreeStack* stack) {
+	ListNode* node = atomic_load(&stack->top);
+	while (node != NULL) {
+		ListNode* next = node->next;
+		free(node);
+		node = next;
+	}
+}
+
+void lock_free_push(LockFreeStack* stack, int value) {
+	ListNode* node = (ListNode*)malloc(sizeof(ListNode));
+	node->value = value;
+	node->next = atomic_load(&stack->top);
+	while (!atomic_compare_exchange_weak(&stack->top, &node->next, node)) {
+	}
+}
+
+bool lock_free_pop(LockFreeStack* stack, int id, RetireList* retired, int* value) {
+	while (true) {
+		ListNode* top = atomic_load(&stack->top);
+		if (top == NULL) {
+			return false;
+		}
+		// top을 보호한 뒤에도 여전히 top인지 확인해야 해제되지 않은 노드임이 보장된다
+		hp_set(id, 0, top);
+		if (atomic_load(&stack->top) != top) {
+			continue;
+		}
+		ListNode* next = top->next;
+		if (atomic_compare_exchange_weak(&stack->top, &top, next)) {
+			hp_clear(id);
+			*value = top->value;
+			hp_retire(retired, top);
+			return true;
+		}
+	}
+}
+
+void init_lock_free_queue(LockFreeQueue* queue) {
+	// 항상 dummy 노드 하나를 가지고 시작한다
+	QueueNode* dummy = (QueueNode*)malloc(sizeof(QueueNode));
+	dummy->value = 0;
+	atomic_init(&dummy->next, NULL);
+	atomic_init(&queue->head, dummy);
+	atomic_init(&queue->tail, dummy);
+}
+
+void destroy_lock_free_queue(LockFreeQueue* queue) {
+	QueueNode* node = atomic_load(&queue->head);
+	while (node != NULL) {
+		QueueNode* next = atomic_load(&node->next);
+		free(node);
+		node = next;
+	}
+}
+
+void lock_free_enqueue(LockFreeQueue* queue, int id, int value) {
+	QueueNode* node = (QueueNode*)malloc(sizeof(QueueNode));
+	node->value = value;
+	atomic_init(&node->next, NULL);
+	while (true) {
+		QueueNode* tail = atomic_load(&queue->tail);
+		hp_set(id, 0, tail);
+		if (atomic_load(&queue->tail) != tail) {
+			continue;
+		}
+		QueueNode* next = atomic_load(&tail->next);
+		if (next != NULL) {
+			// tail이 뒤처져 있으면 앞으로 옮겨 주고 다시 시도한다
+			atomic_compare_exchange_weak(&queue->tail, &tail, next);
+			continue;
+		}
+		QueueNode* expected = NULL;
+		if (atomic_compare_exchange_weak(&tail->next, &expected, node)) {
+			atomic_compare_exchange_strong(&queue->tail, &tail, node);
+			break;
+		}
+	}
+	hp_clear(id);
+}
+
+bool lock_free_dequeue(LockFreeQueue* queue, int id, RetireList* retired, int* value) {
+	while (true) {
+		QueueNode* head = atomic_load(&queue->head);
+		hp_set(id, 0, head);
+		if (atomic_load(&queue->head) != head) {
+			continue;
+		}
+		QueueNode* tail = atomic_load(&queue->tail);
+		QueueNode* next = atomic_load(&head->next);
+		hp_set(id, 1, next);
+		if (atomic_load(&queue->head) != head) {
+			continue;
+		}
+		if (next == NULL) {
+			hp_clear(id);
+			return false; // 비어 있음
+		}
+		if (head == tail) {
+			atomic_compare_exchange_weak(&queue->tail, &tail, next);
+			continue;
+		}
+		int v = next->value;
+		if (atomic_compare_exchange_weak(&queue->head, &head, next)) {
+			hp_clear(id);
+			*value = v;
+			hp_retire(retired, head); // 이전 dummy 노드를 제거하고 next가 새 dummy가 된다
+			return true;
+		}
+	}
+}
+
+void init_locked_stack(LockedStack* stack) {
+	init_atomic_lock(&stack->lock);
+	stack->top = NULL;
+}
+
+void destroy_locked_stack(LockedStack* stack) {
+	ListNode* node = stack->top;
+	while (node != NULL) {
+		ListNode* next = node->next;
+		free(node);
+		node = next;
+	}
+	stack->top = NULL;
+}
+
+ListNode* new_list_node(int value) {
+	ListNode* node = (ListNode*)malloc(sizeof(ListNode));
+	node->value = value;
+	node->next = NULL;
+	return node;
+}
+
+// locked_* 함수는 락을 잡지 않는다. 호출하는 쪽(DEFINE_DS_WORKERS)이 stack->lock / queue->lock을 가지고 있어야 한다
+void locked_push(LockedStack* stack, ListNode* node) {
+	node->next = stack->top;
+	stack->top = node;
+}
+
+// 비어 있으면 NULL
+ListNode* locked_pop(LockedStack* stack) {
+	ListNode* top = stack->top;
+	if (top != NULL) {
+		stack->top = top->next;
+	}
+	return top;
+}
+
+void init_locked_queue(LockedQueue* queue) {
+	init_atomic_lock(&queue->lock);
+	queue->head = NULL;
+	queue->tail = NULL;
+}
+
+void destroy_locked_queue(LockedQueue* queue) {
+	ListNode* node = queue->head;
+	while (node != NULL) {
+		ListNode* next = node->next;
+		free(node);
+		node = next;
+	}
+	queue->head = NULL;
+	queue->tail = NULL;
+}
+
+void locked_enqueue(LockedQueue* queue, ListNode* node) {
+	if (queue->tail == NULL) {
+		queue->head = node;
+	}
+	else {
+		queue->tail->next = node;
+	}
+	queue->tail = node;
+}
+
+// 비어 있으면 NULL
+ListNode* locked_dequeue(LockedQueue* queue) {
+	ListNode* head = queue->head;
+	if (head != NULL) {
+		queue->head = head->next;
+		if (queue->head == NULL) {
+			queue->tail = NULL;
+		}
+	}
+	return head;
+}
+
+// 각 스레드는 값을 하나 넣고 하나 꺼내는 것을 반복한다 (push/pop 50:50)
+// 꺼내기 전에 항상 자신이 하나를 넣었으므로 구조가 비어 있을 수 없고, 꺼낸 값의 합은 expected_sum()과 같아야 한다
+int lock_free_stack_add(void* arg) {
+	DSThreadData* data = (DSThreadData*)arg;
+	LockFreeStack* stack = (LockFreeStack*)data->ds;
+	int value;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		lock_free_push(stack, i);
+		while (!lock_free_pop(stack, data->id, &data->retired, &value)) {
+		}
+		data->pop_sum += value;
+	}
+
+	return 0;
+}
+
+int lock_free_queue_add(void* arg) {
+	DSThreadData* data = (DSThreadData*)arg;
+	LockFreeQueue* queue = (LockFreeQueue*)data->ds;
+	int value;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		lock_free_enqueue(queue, data->id, i);
+		while (!lock_free_dequeue(queue, data->id, &data->retired, &value)) {
+		}
+		data->pop_sum += value;
+	}
+
+	return 0;
+}
+
+// 락마다 전용 작업 함수를 만든다 (락 함수가 루프 안으로 인라인된다)
+// prefix_stack_add : LockedStack, prefix_queue_add : LockedQueue
+// 노드 할당과 해제는 락 밖에서 한다
+#define DEFINE_DS_WORKERS(prefix, lock_fn) \
+	int prefix##_stack_add(void* arg) { \
+		DSThreadData* data = (DSThreadData*)arg; \
+		LockedStack* stack = (LockedStack*)data->ds; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			ListNode* node = new_list_node(i); \
+			lock_fn(&stack->lock); \
+			locked_push(stack, node); \
+			atomic_unlock(&stack->lock); \
+			do { \
+				lock_fn(&stack->lock); \
+				node = locked_pop(stack); \
+				atomic_unlock(&stack->lock); \
+			} while (node == NULL); \
+			data->pop_sum += node->value; \
+			free(node); \
+		} \
+		return 0; \
+	} \
+	int prefix##_queue_add(void* arg) { \
+		DSThreadData* data = (DSThreadData*)arg; \
+		LockedQueue* queue = (LockedQueue*)data->ds; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			ListNode* node = new_list_node(i); \
+			lock_fn(&queue->lock); \
+			locked_enqueue(queue, node); \
+			atomic_unlock(&queue->lock); \
+			do { \
+				lock_fn(&queue->lock); \
+				node = locked_dequeue(queue); \
+				atomic_unlock(&queue->lock); \
+			} while (node == NULL); \
+			data->pop_sum += node->value; \
+			free(node); \
+		} \
+		return 0; \
+	}
+
+DEFINE_DS_WORKERS(tas, tas_lock)
+DEFINE_DS_WORKERS(ttas, ttas_lock)
+DEFINE_DS_WORKERS(back_off, back_off_lock)
+
+// func : lock_free_stack_add, lock_free_queue_add 또는 DEFINE_DS_WORKERS가 만든 prefix_stack_add, prefix_queue_add
+// kind : func가 사용하는 자료 구조 (DS_*)
+void ds_test(int (*func)(void*), const char* name, int kind) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	LockFreeStack lock_free_stack;
+	LockFreeQueue lock_free_queue;
+	LockedStack locked_stack;
+	LockedQueue locked_queue;
+	static DSThreadData data[SIXTYFOUR]; // RetireList가 커서 스택 대신 정적 영역에 둔다
+	void* ds;
+
+	for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+		int n = THREAD_COUNTS[t];
+		init_hazard_slots();
+		init_lock_free_stack(&lock_free_stack);
+		init_lock_free_queue(&lock_free_queue);
+		init_locked_stack(&locked_stack);
+		init_locked_queue(&locked_queue);
+		if (kind == DS_LOCK_FREE_STACK) {
+			ds = &lock_free_stack;
+		}
+		else if (kind == DS_LOCK_FREE_QUEUE) {
+			ds = &lock_free_queue;
+		}
+		else if (kind == DS_LOCKED_STACK) {
+			ds = &locked_stack;
+		}
+		else {
+			ds = &locked_queue;
+		}
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_ds_thread_data(ds, i, range_start(i, n), range_end(i, n));
+		}
+
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], func, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		sum = 0;
+		for (int i = 0; i < n; ++i) {
+			sum += data[i].pop_sum;
+			hp_drain(&data[i].retired);
+		}
+		destroy_lock_free_stack(&lock_free_stack);
+		destroy_lock_free_queue(&lock_free_queue);
+		destroy_locked_stack(&locked_stack);
+		destroy_locked_queue(&locked_queue);
+
+		printf("%d threads\n", n);
+		printf("%s Time: %f\n", name, (double)(end - start) / CLOCKS_PER_SEC);
+		printf("%s Sum: %llu (%s)\n", name, sum, sum == expected_sum() ? "OK" : "FAIL");
+		STATS_PRINT(name);
+	}
+}
+
+// Ring buffer 파이프라인
+// 생산자 스레드는 자신의 구간의 정수를 batch_size개씩 묶어서 링 버퍼에 넣고, 소비자 스레드는 꺼내서 더한다
+// 모든 생산자가 끝나면 마지막 생산자가 소비자 수만큼 빈 묶음(count == 0)을 넣어서 소비자를 끝낸다
+#define RING_CAPACITY (256) // 2의 거듭제곱
+#define MAX_BATCH (64)
+
+#define RING_SPSC (0)
+#define RING_MPMC (1)
+#define RING_LOCKED (2)
+
+typedef struct Batch {
+	int count;
+	long long enqueue_ticks; // 큐 대기 시간 측정용
+	int values[MAX_BATCH];
+} Batch;
+
+// Single-producer single-consumer (Lamport 링 버퍼)
+// head는 소비자만, tail은 생산자만 수정하므로 서로 다른 캐시 라인에 둔다
+typedef struct SPSCRing {
+	atomic_size_t head;
+	char pad1[64 - sizeof(atomic_size_t)];
+	atomic_size_t tail;
+	char pad2[64 - sizeof(atomic_size_t)];
+	Batch* slots;
+} SPSCRing;
+
+// Multi-producer multi-consumer (슬롯별 sequence 번호를 사용하는 Vyukov 링 버퍼)
+// 슬롯의 seq == pos이면 pos 위치에 쓸 수 있고, seq == pos + 1이면 읽을 수 있다
+typedef struct MPMCSlot {
+	atomic_size_t seq;
+	Batch batch;
+} MPMCSlot;
+
+typedef struct MPMCRing {
+	atomic_size_t head;
+	char pad1[64 - sizeof(atomic_size_t)];
+	atomic_size_t tail;
+	char pad2[64 - sizeof(atomic_size_t)];
+	MPMCSlot* slots;
+} MPMCRing;
+
+// 비교용: 뮤텍스와 조건 변수로 보호하는 링 버퍼
+typedef struct LockedRing {
+	mtx_t mutex;
+	cnd_t not_empty;
+	cnd_t not_full;
+	size_t head;
+	size_t tail;
+	Batch* slots;
+} LockedRing;
+
+typedef struct Pipeline {
+	int kind;
+	SPSCRing spsc;
+	MPMCRing mpmc;
+	LockedRing locked;
+	atomic_int active_producers;
+	int consumers;
+	int batch_size;
+} Pipeline;
+
+typedef struct PipelineThreadData {
+	Pipeline* pipeline;
+	int start;
+	int end;
+	unsigned long long local_sum;
+	long long batches;
+	long long latency_ticks;
+	long long max_latency_ticks;
+} PipelineThreadData;
+
+PipelineThreadData init_pipeline_thread_data(Pipeline* p, int start, int end) {
+	PipelineThreadData d;
+	d.pipeline = p;
+	d.start = start;
+	d.end = end;
+	d.local_sum = 0;
+	d.batches = 0;
+	d.latency_ticks = 0;
+	d.max_latency_ticks = 0;
+
+	return d;
+}
+
+void init_pipeline(Pipeline* p, int kind, int producers, int consumers, int batch_size) {
+	p->kind = kind;
+	atomic_init(&p->spsc.head, 0);
+	atomic_init(&p->spsc.tail, 0);
+	p->spsc.slots = (Batch*)malloc(sizeof(Batch) * RING_CAPACITY);
+	atomic_init(&p->mpmc.head, 0);
+	atomic_init(&p->mpmc.tail, 0);
+	p->mpmc.slots = (MPMCSlot*)malloc(sizeof(MPMCSlot) * RING_CAPACITY);
+	for (size_t i = 0; i < RING_CAPACITY; ++i) {
+		atomic_init(&p->mpmc.slots[i].seq, i);
+	}
+	mtx_init(&p->locked.mutex, mtx_plain);
+	cnd_init(&p->locked.not_empty);
+	cnd_init(&p->locked.not_full);
+	p->locked.head = 0;
+	p->locked.tail = 0;
+	p->locked.slots = (Batch*)malloc(sizeof(Batch) * RING_CAPACITY);
+	atomic_init(&p->active_producers, producers);
+	p->consumers = consumers;
+	p->batch_size = batch_size;
+}
+
+void destroy_pipeline(Pipeline* p) {
+	free(p->spsc.slots);
+	free(p->mpmc.slots);
+	mtx_destroy(&p->locked.mutex);
+	cnd_destroy(&p->locked.not_empty);
+	cnd_destroy(&p->locked.not_full);
+	free(p->locked.slots);
+}
+
+bool spsc_push(SPSCRing* ring, const Batch* batch) {
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == RING_CAPACITY) {
+		return false; // 가득 참
+	}
+	ring->slots[tail & (RING_CAPACITY - 1)] = *batch;
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+	return true;
+}
+
+bool spsc_pop(SPSCRing* ring, Batch* batch) {
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if (head == atomic_load_explicit(&ring->tail, memory_order_acquire)) {
+		return false; // 비어 있음
+	}
+	*batch = ring->slots[head & (RING_CAPACITY - 1)];
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	return true;
+}
+
+bool mpmc_push(MPMCRing* ring, const Batch* batch) {
+	size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	MPMCSlot* slot;
+	while (true) {
+		slot = &ring->slots[pos & (RING_CAPACITY - 1)];
+		size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		long long diff = (long long)seq - (long long)pos;
+		if (diff == 0) {
+			// 이 슬롯에 쓸 차례이므로 tail을 차지한다 (실패하면 pos가 최신 tail로 바뀐다)
+			if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			return false; // 가득 참
+		}
+		else {
+			pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		}
+	}
+	slot->batch = *batch;
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+	return true;
+}
+
+bool mpmc_pop(MPMCRing* ring, Batch* batch) {
+	size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	MPMCSlot* slot;
+	while (true) {
+		slot = &ring->slots[pos & (RING_CAPACITY - 1)];
+		size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		long long diff = (long long)seq - (long long)(pos + 1);
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			return false; // 비어 있음
+		}
+		else {
+			pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		}
+	}
+	*batch = slot->batch;
+	// 한 바퀴 뒤의 생산자가 쓸 수 있도록 표시한다
+	atomic_store_explicit(&slot->seq, pos + RING_CAPACITY, memory_order_release);
+	return true;
+}
+
+void locked_ring_push(LockedRing* ring, const Batch* batch) {
+	mtx_lock(&ring->mutex);
+	while (ring->tail - ring->head == RING_CAPACITY) {
+		cnd_wait(&ring->not_full, &ring->mutex);
+	}
+	ring->slots[ring->tail & (RING_CAPACITY - 1)] = *batch;
+	++ring->tail;
+	cnd_signal(&ring->not_empty);
+	mtx_unlock(&ring->mutex);
+}
+
+void locked_ring_pop(LockedRing* ring, Batch* batch) {
+	mtx_lock(&ring->mutex);
+	while (ring->tail == ring->head) {
+		cnd_wait(&ring->not_empty, &ring->mutex);
+	}
+	*batch = ring->slots[ring->head & (RING_CAPACITY - 1)];
+	++ring->head;
+	cnd_signal(&ring->not_full);
+	mtx_unlock(&ring->mutex);
+}
+
+// lock-free 링은 가득 차거나 비어 있으면 양보하면서 다시 시도한다
+void pipeline_push(Pipeline* p, const Batch* batch) {
+	if (p->kind == RING_SPSC) {
+		while (!spsc_push(&p->spsc, batch)) {
+			thrd_yield();
+		}
+	}
+	else if (p->kind == RING_MPMC) {
+		while (!mpmc_push(&p->mpmc, batch)) {
+			thrd_yield();
+		}
+	}
+	else {
+		locked_ring_push(&p->locked, batch);
+	}
+}
+
+void pipeline_pop(Pipeline* p, Batch* batch) {
+	if (p->kind == RING_SPSC) {
+		while (!spsc_pop(&p->spsc, batch)) {
+			thrd_yield();
+		}
+	}
+	else if (p->kind == RING_MPMC) {
+		while (!mpmc_pop(&p->mpmc, batch)) {
+			thrd_yield();
+		}
+	}
+	else {
+		locked_ring_pop(&p->locked, batch);
+	}
+}
+
+int producer(void* arg) {
+	PipelineThreadData* data = (PipelineThreadData*)arg;
+	Pipeline* p = data->pipeline;
+	Batch batch;
+	batch.count = 0;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		batch.values[batch.count++] = i;
+		if (batch.count == p->batch_size || i == data->end) {
+			batch.enqueue_ticks = now_ticks();
+			pipeline_push(p, &batch);
+			batch.count = 0;
+		}
+	}
+
+	// 마지막 생산자가 소비자 수만큼 종료 표시를 넣는다
+	if (atomic_fetch_sub(&p->active_producers, 1) == 1) {
+		batch.count = 0;
+		for (int i = 0; i < p->consumers; ++i) {
+			batch.enqueue_ticks = now_ticks();
+			pipeline_push(p, &batch);
+		}
+	}
+
+	return 0;
+}
+
+int consumer(void* arg) {
+	PipelineThreadData* data = (PipelineThreadData*)arg;
+	Pipeline* p = data->pipeline;
+	Batch batch;
+
+	while (true) {
+		pipeline_pop(p, &batch);
+		if (batch.count == 0) {
+			break; // 종료 표시
+		}
+		long long latency = now_ticks() - batch.enqueue_ticks;
+		data->latency_ticks += latency;
+		if (latency > data->max_latency_ticks) {
+			data->max_latency_ticks = latency;
+		}
+		++data->batches;
+		for (int i = 0; i < batch.count; ++i) {
+			data->local_sum += batch.values[i];
+		}
+	}
+
+	return 0;
+}
+
+// {생산자 수, 소비자 수}
+const int PIPELINE_RATIOS[][2] = { { 1, 1 }, { 1, 4 }, { 4, 1 }, { 2, 2 }, { 4, 4 }, { 8, 8 }, { 16, 16 } };
+#define PIPELINE_RATIO_NUM (7)
+const int PIPELINE_BATCHES[] = { 1, 16, MAX_BATCH };
+#define PIPELINE_BATCH_NUM (3)
+
+void pipeline_test(int kind, const char* name) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[2 * SIXTEEN];
+	PipelineThreadData data[2 * SIXTEEN];
+	Pipeline pipeline;
+
+	for (int r = 0; r < PIPELINE_RATIO_NUM; ++r) {
+		int producers = PIPELINE_RATIOS[r][0];
+		int consumers = PIPELINE_RATIOS[r][1];
+		if (kind == RING_SPSC && (producers != 1 || consumers != 1)) {
+			continue; // SPSC 링은 1:1만 가능
+		}
+		for (int b = 0; b < PIPELINE_BATCH_NUM; ++b) {
+			int batch_size = PIPELINE_BATCHES[b];
+			init_pipeline(&pipeline, kind, producers, consumers, batch_size);
+
+			// 각각의 스레드에 전달할 데이터 설정 (생산자 먼저, 그 다음 소비자)
+			for (int i = 0; i < producers; ++i) {
+				data[i] = init_pipeline_thread_data(&pipeline, range_start(i, producers), range_end(i, producers));
+			}
+			for (int i = 0; i < consumers; ++i) {
+				data[producers + i] = init_pipeline_thread_data(&pipeline, 0, -1);
+			}
+
+			for (int i = 0; i < producers + consumers; ++i) {
+				if (thrd_create(&threads[i], i < producers ? producer : consumer, &data[i]) != thrd_success) {
+					printf("Error creating thread %d\n", i);
+					return;
+				}
+			}
+			start = clock();
+			for (int i = 0; i < producers + consumers; ++i) {
+				thrd_join(threads[i], NULL);
+			}
+			end = clock();
+
+			long long batches = 0;
+			long long latency_ticks = 0;
+			long long max_latency_ticks = 0;
+			sum = 0;
+			for (int i = producers; i < producers + consumers; ++i) {
+				sum += data[i].local_sum;
+				batches += data[i].batches;
+				latency_ticks += data[i].latency_ticks;
+				if (data[i].max_latency_ticks > max_latency_ticks) {
+					max_latency_ticks = data[i].max_latency_ticks;
+				}
+			}
+			destroy_pipeline(&pipeline);
+
+			double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+			printf("%d producers, %d consumers, batch %d\n", producers, consumers, batch_size);
+			printf("%s Time: %f\n", name, seconds);
+			printf("%s Sum: %llu (%s)\n", name, sum, sum == expected_sum() ? "OK" : "FAIL");
+			printf("%s Throughput: %.0f items/s\n", name, seconds > 0 ? (MAX_NUM - MIN_NUM + 1) / seconds : 0.0);
+			printf("%s Latency: avg %.2f us, max %.2f us\n", name,
+				batches > 0 ? ticks_to_us(latency_ticks) / batches : 0.0, ticks_to_us(max_latency_ticks));
+		}
+	}
+}
+
+// 과다 구독(코어 수보다 많은 스레드) 테스트
+// 락을 가진 스레드가 선점되는 상황을 흉내 내기 위해 임계 구역 안에서 양보하거나 오래 머문다
+#define PREEMPT_NONE (0)
+#define PREEMPT_YIELD (1)
+#define PREEMPT_DELAY (2)
+
+#define LOCK_TAS (0)
+#define LOCK_TTAS (1)
+#define LOCK_BACK_OFF (2)
+#define LOCK_TICKET (3)
+#define LOCK_MCS (4)
+#define LOCK_TO (5)
+#define LOCK_ADAPTIVE (6)
+#define LOCK_KIND_NUM (7)
+
+const char* LOCK_NAMES[LOCK_KIND_NUM] = { "TASLock", "TTASLock", "Backoff", "TicketLock", "MCSLock", "TOLock", "AdaptiveLock" };
+
+// 코어 수 대비 스레드 수 배율 (1배는 비교 기준)
+const int OVERSUB_FACTORS[] = { 1, 2, 4, 8 };
+#define OVERSUB_FACTOR_NUM (4)
+
+typedef struct OversubLocks {
+	AtomicLock atomic;
+	TicketLock ticket;
+	MCSLock mcs;
+	TOLock to;
+	AdaptiveLock adaptive;
+} OversubLocks;
+
+typedef struct OversubThreadData {
+	alignas(CACHE_LINE) MCSNode mcs_node; // 캐시 라인 하나를 차지한다 (구조체 크기도 CACHE_LINE의 배수가 된다)
+	OversubLocks* locks;
+	int kind;
+	int preempt_mode;
+	TOThreadNode to_node;
+	int start;
+	int end;
+} OversubThreadData;
+
+OversubThreadData init_oversub_thread_data(OversubLocks* locks, int kind, int preempt_mode, int start, int end) {
+	OversubThreadData d;
+	d.locks = locks;
+	d.kind = kind;
+	d.preempt_mode = preempt_mode;
+	d.to_node.my_node = NULL;
+	d.to_node.free_list = NULL;
+	d.start = start;
+	d.end = end;
+
+	return d;
+}
+
+void init_oversub_locks(OversubLocks* locks) {
+	init_atomic_lock(&locks->atomic);
+	init_ticket_lock(&locks->ticket);
+	init_mcs_lock(&locks->mcs);
+	init_to_lock(&locks->to);
+	init_adaptive_lock(&locks->adaptive);
+}
+
+// PREEMPT_INTERVAL번에 한 번씩 락을 가진 채로 선점된 것처럼 행동한다
+void preempt_holder(int mode, int i) {
+	if (mode == PREEMPT_NONE || i % PREEMPT_INTERVAL != 0) {
+		return;
+	}
+	if (mode == PREEMPT_YIELD) {
+		thrd_yield();
+	}
+	else {
+		for (volatile int k = 0; k < PREEMPT_DELAY_SPINS; ++k) {
+		}
+	}
+}
+
+// prefix_oversub_add : lock_stmt와 unlock_stmt가 직접 들어간 전용 작업 함수
+// 락마다 인자 모양이 다르므로 (MCS/TO는 스레드 노드도 넘긴다) 함수 이름 대신 data를 쓰는 호출식을 받는다
+#define DEFINE_OVERSUB_WORKERS(prefix, lock_stmt, unlock_stmt) \
+	int prefix##_oversub_add(void* arg) { \
+		OversubThreadData* data = (OversubThreadData*)arg; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			lock_stmt; \
+			sum += i; \
+			preempt_holder(data->preempt_mode, i); \
+			unlock_stmt; \
+		} \
+		return 0; \
+	}
+
+DEFINE_OVERSUB_WORKERS(tas, tas_lock(&data->locks->atomic), atomic_unlock(&data->locks->atomic))
+DEFINE_OVERSUB_WORKERS(ttas, ttas_lock(&data->locks->atomic), atomic_unlock(&data->locks->atomic))
+DEFINE_OVERSUB_WORKERS(back_off, back_off_lock(&data->locks->atomic), atomic_unlock(&data->locks->atomic))
+DEFINE_OVERSUB_WORKERS(ticket, ticket_lock(&data->locks->ticket), ticket_unlock(&data->locks->ticket))
+DEFINE_OVERSUB_WORKERS(mcs, mcs_lock(&data->locks->mcs, &data->mcs_node), mcs_unlock(&data->locks->mcs, &data->mcs_node))
+DEFINE_OVERSUB_WORKERS(to, to_lock(&data->locks->to, &data->to_node), to_unlock(&data->locks->to, &data->to_node))
+DEFINE_OVERSUB_WORKERS(adaptive, adaptive_lock(&data->locks->adaptive), adaptive_unlock(&data->locks->adaptive))
+
+// LOCK_* 순서대로 (스레드를 만들 때 한 번만 고르므로 반복마다 락 종류를 분기하지 않는다)
+int (*const OVERSUB_WORKERS[LOCK_KIND_NUM])(void*) = {
+	tas_oversub_add, ttas_oversub_add, back_off_oversub_add, ticket_oversub_add, mcs_oversub_add, to_oversub_add, adaptive_oversub_add
+};
+
+void oversub_test(int preempt_mode) {
+	clock_t start;
+	clock_t end;
+	int cores = lock_cpu_count();
+	int max_threads = cores * OVERSUB_FACTORS[OVERSUB_FACTOR_NUM - 1];
+	thrd_t* threads = (thrd_t*)malloc(sizeof(thrd_t) * max_threads);
+	OversubThreadData* data = (OversubThreadData*)_aligned_malloc(sizeof(OversubThreadData) * max_threads, CACHE_LINE);
+	OversubLocks locks;
+
+	printf("%d cores\n", cores);
+	for (int kind = 0; kind < LOCK_KIND_NUM; ++kind) {
+		double base_time = 0.0;
+		for (int f = 0; f < OVERSUB_FACTOR_NUM; ++f) {
+			int n = cores * OVERSUB_FACTORS[f];
+			init_oversub_locks(&locks);
+
+			// 각각의 스레드에 전달할 데이터 설정
+			for (int i = 0; i < n; ++i) {
+				data[i] = init_oversub_thread_data(&locks, kind, preempt_mode, range_start(i, n), range_end(i, n));
+			}
+
+			sum = 0;
+			for (int i = 0; i < n; ++i) {
+				if (thrd_create(&threads[i], OVERSUB_WORKERS[kind], &data[i]) != thrd_success) {
+					printf("Error creating thread %d\n", i);
+					free(threads);
+					_aligned_free(data);
+					return;
+				}
+			}
+			start = clock();
+			for (int i = 0; i < n; ++i) {
+				thrd_join(threads[i], NULL);
+			}
+			end = clock();
+			destroy_to_lock(&locks.to);
+
+			double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+			if (f == 0) {
+				base_time = seconds;
+			}
+			printf("%d threads (%dx cores)\n", n, OVERSUB_FACTORS[f]);
+			printf("%s Time: %f\n", LOCK_NAMES[kind], seconds);
+			printf("%s Sum: %llu\n", LOCK_NAMES[kind], sum);
+			STATS_PRINT(LOCK_NAMES[kind]);
+			printf("%s Slowdown vs 1x: %.2f\n", LOCK_NAMES[kind], base_time > 0 ? seconds / base_time : 0.0);
+		}
+	}
+
+	free(threads);
+	_aligned_free(data);
+}
+
+// CPU 효율 측정
+// 스핀 락은 벽시계 시간으로는 빨라 보여도 기다리는 동안 코어를 계속 태운다
+// 같은 작업을 하는 동안 프로세스가 쓴 CPU 시간(user + kernel)을 벽시계 시간과 함께 재서
+// 임계 구역 백만 번당 CPU 초와 평균적으로 몇 개의 코어를 사용했는지를 비교한다
+typedef struct CpuTimes {
+	double user;   // 초
+	double kernel; // 초
+} CpuTimes;
+
+double filetime_to_seconds(FILETIME t) {
+	// FILETIME은 100ns 단위
+	unsigned long long value = ((unsigned long long)t.dwHighDateTime << 32) | t.dwLowDateTime;
+	return value / 1e7;
+}
+
+CpuTimes process_cpu_times(void) {
+	FILETIME creation_time;
+	FILETIME exit_time;
+	FILETIME kernel_time;
+	FILETIME user_time;
+	CpuTimes times = { 0.0, 0.0 };
+	if (GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time)) {
+		times.user = filetime_to_seconds(user_time);
+		times.kernel = filetime_to_seconds(kernel_time);
+	}
+	return times;
+}
+
+// 컨텍스트 스위치 횟수
+// Windows에는 getrusage처럼 자발적/비자발적 스위치를 나눠 세는 카운터가 없고, 스레드별 전체 횟수만 있다
+// NtQuerySystemInformation(SystemProcessInformation)이 돌려주는 스레드 정보에서 읽는데, 살아 있는 스레드만 보이므로
+// 작업 스레드는 일을 마친 뒤 배리어에서 기다리고, 그동안 메인 스레드가 한 번에 읽는다
+typedef struct EfficiencyThreadData {
+	OversubThreadData* work;
+	FutexBarrier* barrier; // 작업 스레드 n개 + 메인 스레드
+	BarrierLocal local;
+	DWORD thread_id;
+	unsigned long context_switches;
+} EfficiencyThreadData;
+
+int efficiency_add(void* arg) {
+	EfficiencyThreadData* data = (EfficiencyThreadData*)arg;
+	data->thread_id = GetCurrentThreadId();
+	OVERSUB_WORKERS[data->work->kind](data->work);
+	futex_barrier_wait(data->barrier, &data->local); // 일을 마쳤다
+	futex_barrier_wait(data->barrier, &data->local); // 메인 스레드가 횟수를 다 읽었다
+
+	return 0;
+}
+
+// 실패하면 false (횟수는 건드리지 않는다)
+// 배리어에서 잠들면서 생긴 스위치 한 번이 포함된다
+bool read_context_switches(EfficiencyThreadData* data, int n) {
+	ULONG size = 1 << 20;
+	void* buffer = NULL;
+	NTSTATUS status;
+	while (true) {
+		buffer = malloc(size);
+		if (buffer == NULL) {
+			return false;
+		}
+		status = NtQuerySystemInformation(SystemProcessInformation, buffer, size, &size);
+		if (status != STATUS_INFO_LENGTH_MISMATCH) {
+			break;
+		}
+		free(buffer);
+		size += 1 << 16; // 다시 부르는 사이에 프로세스/스레드가 늘어날 수 있다
+	}
+	if (!NT_SUCCESS(status)) {
+		free(buffer);
+		return false;
+	}
+
+	bool found = false;
+	SYSTEM_PROCESS_INFORMATION* process = (SYSTEM_PROCESS_INFORMATION*)buffer;
+	while (true) {
+		if ((DWORD)(ULONG_PTR)process->UniqueProcessId == GetCurrentProcessId()) {
+			// 스레드 정보 배열은 프로세스 정보 바로 뒤에 붙어 있다
+			SYSTEM_THREAD_INFORMATION* threads = (SYSTEM_THREAD_INFORMATION*)(process + 1);
+			for (ULONG t = 0; t < process->NumberOfThreads; ++t) {
+				DWORD id = (DWORD)(ULONG_PTR)threads[t].ClientId.UniqueThread;
+				for (int i = 0; i < n; ++i) {
+					if (data[i].thread_id == id) {
+						data[i].context_switches = threads[t].Reserved3; // Reserved3 = ContextSwitches
+					}
+				}
+			}
+			found = true;
+			break;
+		}
+		if (process->NextEntryOffset == 0) {
+			break;
+		}
+		process = (SYSTEM_PROCESS_INFORMATION*)((char*)process + process->NextEntryOffset);
+	}
+	free(buffer);
+
+	return found;
+}
+
+void efficiency_test(void) {
+	thrd_t threads[SIXTYFOUR];
+	OversubThreadData* data = (OversubThreadData*)_aligned_malloc(sizeof(OversubThreadData) * SIXTYFOUR, CACHE_LINE);
+	EfficiencyThreadData efficiency[SIXTYFOUR];
+	FutexBarrier barrier;
+	BarrierLocal main_local = init_barrier_local(SIXTYFOUR);
+	OversubLocks locks;
+	int cores = lock_cpu_count();
+	double ops = (double)(MAX_NUM - MIN_NUM + 1);
+
+	printf("%d cores\n", cores);
+	for (int kind = 0; kind < LOCK_KIND_NUM; ++kind) {
+		for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+			int n = THREAD_COUNTS[t];
+			init_oversub_locks(&locks);
+
+			// 각각의 스레드에 전달할 데이터 설정
+			init_futex_barrier(&barrier, n + 1);
+			for (int i = 0; i < n; ++i) {
+				data[i] = init_oversub_thread_data(&locks, kind, PREEMPT_NONE, range_start(i, n), range_end(i, n));
+				efficiency[i].work = &data[i];
+				efficiency[i].barrier = &barrier;
+				efficiency[i].local = init_barrier_local(i);
+				efficiency[i].thread_id = 0;
+				efficiency[i].context_switches = 0;
+			}
+
+			sum = 0;
+			// 스레드는 생성되자마자 돌기 시작하므로 CPU 시간과 벽시계 시간 모두 생성 전부터 잰다
+			CpuTimes cpu_start = process_cpu_times();
+			long long start = now_ticks();
+			for (int i = 0; i < n; ++i) {
+				if (thrd_create(&threads[i], efficiency_add, &efficiency[i]) != thrd_success) {
+					printf("Error creating thread %d\n", i);
+					_aligned_free(data);
+					return;
+				}
+			}
+			futex_barrier_wait(&barrier, &main_local); // 모든 작업 스레드가 일을 마쳤다
+			long long end = now_ticks();
+			CpuTimes cpu_end = process_cpu_times();
+			bool switches_ok = read_context_switches(efficiency, n);
+			futex_barrier_wait(&barrier, &main_local);
+			for (int i = 0; i < n; ++i) {
+				thrd_join(threads[i], NULL);
+			}
+			destroy_to_lock(&locks.to);
+
+			double wall = ticks_to_us(end - start) / 1e6;
+			double user = cpu_end.user - cpu_start.user;
+			double kernel = cpu_end.kernel - cpu_start.kernel;
+			double cpu = user + kernel;
+			printf("%d threads\n", n);
+			printf("%s Time: %f\n", LOCK_NAMES[kind], wall);
+			printf("%s Sum: %llu\n", LOCK_NAMES[kind], sum);
+			STATS_PRINT(LOCK_NAMES[kind]);
+			printf("%s CPU: user %f, kernel %f\n", LOCK_NAMES[kind], user, kernel);
+			printf("%s CPU per 1M ops: %f\n", LOCK_NAMES[kind], cpu / (ops / 1e6));
+			printf("%s Core utilization: %.2f / %d\n", LOCK_NAMES[kind], wall > 0 ? cpu / wall : 0.0, cores);
+			if (switches_ok) {
+				unsigned long long total = 0;
+				unsigned long max_switches = 0;
+				for (int i = 0; i < n; ++i) {
+					total += efficiency[i].context_switches;
+					if (efficiency[i].context_switches > max_switches) {
+						max_switches = efficiency[i].context_switches;
+					}
+				}
+				printf("%s Context switches: total %llu, per thread %.1f, max %lu (voluntary/involuntary split unavailable on Windows)\n",
+					LOCK_NAMES[kind], total, (double)total / n, max_switches);
+			}
+			else {
+				printf("%s Context switches: unavailable (NtQuerySystemInformation failed)\n", LOCK_NAMES[kind]);
+			}
+		}
+	}
+
+	_aligned_free(data);
+}
+
+// 부하 변화 테스트
+// 같은 AdaptiveLock 하나를 스레드 수를 2 → 64 → 2로 바꿔 가며 계속 사용해서 모드가 부하를 따라가는지 본다
+void adaptive_test(void) {
+	thrd_t threads[SIXTYFOUR];
+	OversubThreadData* data = (OversubThreadData*)_aligned_malloc(sizeof(OversubThreadData) * SIXTYFOUR, CACHE_LINE);
+	OversubLocks locks;
+	clock_t start;
+	clock_t end;
+
+	init_oversub_locks(&locks);
+	for (int phase = 0; phase < 2 * THREAD_COUNT_NUM; ++phase) {
+		int n = phase < THREAD_COUNT_NUM ? THREAD_COUNTS[phase] : THREAD_COUNTS[2 * THREAD_COUNT_NUM - 1 - phase];
+		long long switches = locks.adaptive.switches;
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_oversub_thread_data(&locks, LOCK_ADAPTIVE, PREEMPT_NONE, range_start(i, n), range_end(i, n));
+		}
+
+		sum = 0;
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], adaptive_oversub_add, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				destroy_to_lock(&locks.to);
+				_aligned_free(data);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		printf("%d threads\n", n);
+		printf("AdaptiveLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
+		printf("AdaptiveLock Sum: %llu\n", sum);
+		STATS_PRINT("AdaptiveLock");
+		printf("AdaptiveLock Mode: %s, contention %.2f, switches %lld\n", ADAPTIVE_MODE_NAMES[atomic_load(&locks.adaptive.mode)],
+			(double)locks.adaptive.contention / ADAPTIVE_SCALE, locks.adaptive.switches - switches);
+	}
+	destroy_to_lock(&locks.to);
+
+	_aligned_free(data);
+}
+
+// 캐시 라인 배치 실험
+// 락과 보호하는 데이터를 같은 캐시 라인에 둘지/다른 캐시 라인에 둘지, 스레드별 데이터를 패딩할지/빽빽하게 둘지를 바꿔 가며 측정한다
+#define LAYOUT_COLOCATED (0) // 락과 데이터가 같은 캐시 라인
+#define LAYOUT_SEPARATED (1) // 락과 데이터가 각각 다른 캐시 라인
+
+typedef struct CoLocatedLayout {
+	alignas(CACHE_LINE) AtomicLock lock;
+	unsigned long long sum;
+} CoLocatedLayout;
+
+typedef struct SeparatedLayout {
+	alignas(CACHE_LINE) AtomicLock lock;
+	alignas(CACHE_LINE) unsigned long long sum;
+} SeparatedLayout;
+
+// 스레드는 매 반복마다 자신의 ops를 증가시키므로 빽빽하게 두면 이웃 스레드와 캐시 라인을 공유한다 (false sharing)
+typedef struct LayoutThreadData {
+	AtomicLock* lock;
+	unsigned long long* target;
+	int start;
+	int end;
+	long long ops;
+} LayoutThreadData;
+
+// 스레드마다 캐시 라인 하나 이상을 차지하도록 정렬한 버전
+typedef struct PaddedLayoutThreadData {
+	alignas(CACHE_LINE) LayoutThreadData d;
+} PaddedLayoutThreadData;
+
+LayoutThreadData init_layout_thread_data(AtomicLock* l, unsigned long long* target, int start, int end) {
+	LayoutThreadData d;
+	d.lock = l;
+	d.target = target;
+	d.start = start;
+	d.end = end;
+	d.ops = 0;
+
+	return d;
+}
+
+// 락마다 전용 작업 함수 prefix_layout_add를 만든다 (락 함수가 루프 안으로 인라인된다)
+#define DEFINE_LAYOUT_WORKERS(prefix, lock_fn) \
+	int prefix##_layout_add(void* arg) { \
+		LayoutThreadData* data = (LayoutThreadData*)arg; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			lock_fn(data->lock); \
+			*data->target += i; \
+			atomic_unlock(data->lock); \
+			++data->ops; \
+		} \
+		return 0; \
+	}
+
+DEFINE_LAYOUT_WORKERS(tas, tas_lock)
+DEFINE_LAYOUT_WORKERS(ttas, ttas_lock)
+
+// func : DEFINE_LAYOUT_WORKERS가 만든 prefix_layout_add
+void layout_test(const char* name, int (*func)(void*), int lock_layout, bool padded) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	CoLocatedLayout* colocated = (CoLocatedLayout*)_aligned_malloc(sizeof(CoLocatedLayout), CACHE_LINE);
+	SeparatedLayout* separated = (SeparatedLayout*)_aligned_malloc(sizeof(SeparatedLayout), CACHE_LINE);
+	LayoutThreadData* packed_data = (LayoutThreadData*)_aligned_malloc(sizeof(LayoutThreadData) * SIXTYFOUR, CACHE_LINE);
+	PaddedLayoutThreadData* padded_data = (PaddedLayoutThreadData*)_aligned_malloc(sizeof(PaddedLayoutThreadData) * SIXTYFOUR, CACHE_LINE);
+	AtomicLock* lock = lock_layout == LAYOUT_COLOCATED ? &colocated->lock : &separated->lock;
+	unsigned long long* target = lock_layout == LAYOUT_COLOCATED ? &colocated->sum : &separated->sum;
+
+	printf("%s, lock and data %s, thread data %s\n", name,
+		lock_layout == LAYOUT_COLOCATED ? "co-located" : "separated", padded ? "padded" : "packed");
+	for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+		int n = THREAD_COUNTS[t];
+		init_atomic_lock(lock);
+		*target = 0;
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			LayoutThreadData d = init_layout_thread_data(lock, target, range_start(i, n), range_end(i, n));
+			if (padded) {
+				padded_data[i].d = d;
+			}
+			else {
+				packed_data[i] = d;
+			}
+		}
+
+		for (int i = 0; i < n; ++i) {
+			void* arg = padded ? (void*)&padded_data[i].d : (void*)&packed_data[i];
+			if (thrd_create(&threads[i], func, arg) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				_aligned_free(colocated);
+				_aligned_free(separated);
+				_aligned_free(packed_data);
+				_aligned_free(padded_data);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+
+		printf("%d threads\n", n);
+		printf("%s Time: %f\n", name, (double)(end - start) / CLOCKS_PER_SEC);
+		printf("%s Sum: %llu\n", name, *target);
+		STATS_PRINT(name);
+	}
+
+	_aligned_free(colocated);
+	_aligned_free(separated);
+	_aligned_free(packed_data);
+	_aligned_free(padded_data);
+}
+
+// Memory ordering 변형 비교
+// Locks.h의 acquire/release, relaxed, strong/weak CAS 변형을 같은 작업으로 돌려 기본(seq_cst) 락과 비교한다
+typedef struct OrderingThreadData {
+	AtomicLock* lock;
+	int start;
+	int end;
+} OrderingThreadData;
+
+OrderingThreadData init_ordering_thread_data(AtomicLock* l, int start, int end) {
+	OrderingThreadData d;
+	d.lock = l;
+	d.start = start;
+	d.end = end;
+
+	return d;
+}
+
+// 변형마다 전용 작업 함수 prefix_ordering_add를 만든다 (락 함수가 루프 안으로 인라인된다)
+#define DEFINE_ORDERING_WORKERS(prefix, lock_fn, unlock_fn) \
+	int prefix##_ordering_add(void* arg) { \
+		OrderingThreadData* data = (OrderingThreadData*)arg; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			lock_fn(data->lock); \
+			sum += i; \
+			unlock_fn(data->lock); \
+		} \
+		return 0; \
+	}
+
+DEFINE_ORDERING_WORKERS(tas, tas_lock, atomic_unlock)
+DEFINE_ORDERING_WORKERS(tas_strong, tas_lock_strong, atomic_unlock)
+DEFINE_ORDERING_WORKERS(tas_acq, tas_lock_acq, atomic_unlock_release)
+DEFINE_ORDERING_WORKERS(tas_acq_strong, tas_lock_acq_strong, atomic_unlock_release)
+DEFINE_ORDERING_WORKERS(tas_relaxed, tas_lock_relaxed, atomic_unlock_relaxed)
+DEFINE_ORDERING_WORKERS(ttas, ttas_lock, atomic_unlock)
+DEFINE_ORDERING_WORKERS(ttas_strong, ttas_lock_strong, atomic_unlock)
+DEFINE_ORDERING_WORKERS(ttas_acq, ttas_lock_acq, atomic_unlock_release)
+DEFINE_ORDERING_WORKERS(ttas_acq_strong, ttas_lock_acq_strong, atomic_unlock_release)
+DEFINE_ORDERING_WORKERS(ttas_relaxed, ttas_lock_relaxed, atomic_unlock_relaxed)
+DEFINE_ORDERING_WORKERS(back_off, back_off_lock, atomic_unlock)
+DEFINE_ORDERING_WORKERS(back_off_strong, back_off_lock_strong, atomic_unlock)
+DEFINE_ORDERING_WORKERS(back_off_acq, back_off_lock_acq, atomic_unlock_release)
+DEFINE_ORDERING_WORKERS(back_off_acq_strong, back_off_lock_acq_strong, atomic_unlock_release)
+DEFINE_ORDERING_WORKERS(back_off_relaxed, back_off_lock_relaxed, atomic_unlock_relaxed)
+
+typedef struct OrderingVariant {
+	const char* name;
+	int (*func)(void*);
+	bool unsafe; // 락으로서 틀린 구현 (sum이 맞게 나와도 검증된 것이 아니다)
+} OrderingVariant;
+
+const OrderingVariant ORDERING_VARIANTS[] = {
+	{ "TAS seq_cst weak", tas_ordering_add, false },
+	{ "TAS seq_cst strong", tas_strong_ordering_add, false },
+	{ "TAS acq/rel weak", tas_acq_ordering_add, false },
+	{ "TAS acq/rel strong", tas_acq_strong_ordering_add, false },
+	{ "TAS relaxed (UNSAFE)", tas_relaxed_ordering_add, true },
+	{ "TTAS seq_cst weak", ttas_ordering_add, false },
+	{ "TTAS seq_cst strong", ttas_strong_ordering_add, false },
+	{ "TTAS acq/rel weak", ttas_acq_ordering_add, false },
+	{ "TTAS acq/rel strong", ttas_acq_strong_ordering_add, false },
+	{ "TTAS relaxed (UNSAFE)", ttas_relaxed_ordering_add, true },
+	{ "Backoff seq_cst weak", back_off_ordering_add, false },
+	{ "Backoff seq_cst strong", back_off_strong_ordering_add, false },
+	{ "Backoff acq/rel weak", back_off_acq_ordering_add, false },
+	{ "Backoff acq/rel strong", back_off_acq_strong_ordering_add, false },
+	{ "Backoff relaxed (UNSAFE)", back_off_relaxed_ordering_add, true },
+};
+#define ORDERING_VARIANT_NUM ((int)(sizeof ORDERING_VARIANTS / sizeof *ORDERING_VARIANTS))
+#define ORDERING_ROUNDS (3) // 변형마다 검증을 반복하는 횟수
+
+// 모든 변형을 ORDERING_ROUNDS번씩 실행하고 sum이 expected_sum()과 다르면 그 변형을 탈락시킨다
+// 틀린 변형이 더 빠르게 나오더라도 결과에서 제외되도록 하기 위함
+// unsafe 변형은 x86에서는 대부분 sum이 맞게 나오지만 데이터 레이스가 있으므로 Sum OK로 표시하지 않는다
+void ordering_test(void) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	AtomicLock lock;
+	OrderingThreadData data[SIXTYFOUR];
+
+	for (int v = 0; v < ORDERING_VARIANT_NUM; ++v) {
+		const OrderingVariant* variant = &ORDERING_VARIANTS[v];
+		bool rejected = false;
+		for (int t = 0; t < THREAD_COUNT_NUM && !rejected; ++t) {
+			int n = THREAD_COUNTS[t];
+			double best = 0.0;
+			for (int round = 0; round < ORDERING_ROUNDS; ++round) {
+				init_atomic_lock(&lock);
+
+				// 각각의 스레드에 전달할 데이터 설정
+				for (int i = 0; i < n; ++i) {
+					data[i] = init_ordering_thread_data(&lock, range_start(i, n), range_end(i, n));
+				}
+
+				sum = 0;
+				for (int i = 0; i < n; ++i) {
+					if (thrd_create(&threads[i], variant->func, &data[i]) != thrd_success) {
+						printf("Error creating thread %d\n", i);
+						return;
+					}
+				}
+				start = clock();
+				for (int i = 0; i < n; ++i) {
+					thrd_join(threads[i], NULL);
+				}
+				end = clock();
+
+				if (sum != expected_sum()) {
+					printf("%d threads\n", n);
+					printf("%s REJECTED: Sum %llu != %llu (round %d)\n", variant->name, sum, expected_sum(), round + 1);
+					rejected = true;
+					STATS_RESET();
+					break;
+				}
+				double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+				if (round == 0 || seconds < best) {
+					best = seconds;
+				}
+			}
+			if (!rejected) {
+				printf("%d threads\n", n);
+				if (variant->unsafe) {
+					printf("%s Time: %f (best of %d, UNSAFE: data race, matching Sum is not a validation)\n", variant->name, best, ORDERING_ROUNDS);
+				}
+				else {
+					printf("%s Time: %f (best of %d, Sum OK)\n", variant->name, best, ORDERING_ROUNDS);
+				}
+				STATS_PRINT(variant->name); // ORDERING_ROUNDS번의 합계
+			}
+		}
+	}
+}
+
+// Lock striping 해시 맵
+// 고정 크기 open addressing 테이블을 stripe_count개의 연속된 구역으로 나누고, 구역마다 락을 하나씩 둔다
+// 키는 해시로 구역이 정해지고 선형 탐사도 그 구역 안에서만 하므로, 한 키에 대한 연산은 항상 같은 락 하나만 잡는다
+#define HASH_TABLE_SIZE (1 << 16)
+#define HASH_KEY_NUM (8192) // 키는 1 ~ HASH_KEY_NUM (0은 빈 칸)
+#define ZIPF_S (0.99)
+
+#define KEYS_UNIFORM (0)
+#define KEYS_ZIPF (1)
+
+const int STRIPE_COUNTS[] = { 1, 4, 16, 64, 256 };
+#define STRIPE_COUNT_NUM (5)
+
+typedef struct HashEntry {
+	int key;
+	unsigned long long value;
+} HashEntry;
+
+typedef struct LockStripe {
+	alignas(CACHE_LINE) AtomicLock lock;
+} LockStripe;
+
+typedef struct StripedHashMap {
+	HashEntry* entries;
+	LockStripe* stripes;
+	int stripe_count;
+	int segment_size;
+} StripedHashMap;
+
+typedef struct HashThreadData {
+	StripedHashMap* map;
+	int distribution;
+	unsigned long long rng;
+	int start;
+	int end;
+} HashThreadData;
+
+// Zipf 분포의 누적 분포 (순위가 낮은 키일수록 자주 뽑힌다)
+double zipf_cdf[HASH_KEY_NUM];
+
+void init_zipf_cdf(void) {
+	double total = 0.0;
+	for (int k = 0; k < HASH_KEY_NUM; ++k) {
+		total += 1.0 / pow(k + 1, ZIPF_S);
+		zipf_cdf[k] = total;
+	}
+	for (int k = 0; k < HASH_KEY_NUM; ++k) {
+		zipf_cdf[k] /= total;
+	}
+}
+
+// xorshift64 난수 생성기 (스레드마다 상태를 따로 가진다)
+unsigned long long next_random(unsigned long long* state) {
+	unsigned long long x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return x;
+}
+
+int next_key(HashThreadData* data) {
+	unsigned long long r = next_random(&data->rng);
+	if (data->distribution == KEYS_UNIFORM) {
+		return (int)(r % HASH_KEY_NUM) + 1;
+	}
+	double u = (double)(r >> 11) / (double)(1ULL << 53);
+	int low = 0;
+	int high = HASH_KEY_NUM - 1;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (zipf_cdf[mid] < u) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low + 1;
+}
+
+HashThreadData init_hash_thread_data(StripedHashMap* map, int distribution, int id, int start, int end) {
+	HashThreadData d;
+	d.map = map;
+	d.distribution = distribution;
+	d.rng = 0x9E3779B97F4A7C15ULL * (id + 1);
+	d.start = start;
+	d.end = end;
+
+	return d;
+}
+
+void init_striped_hash_map(StripedHashMap* map, int stripe_count) {
+	map->entries = (HashEntry*)calloc(HASH_TABLE_SIZE, sizeof(HashEntry));
+	map->stripes = (LockStripe*)_aligned_malloc(sizeof(LockStripe) * stripe_count, CACHE_LINE);
+	for (int i = 0; i < stripe_count; ++i) {
+		init_atomic_lock(&map->stripes[i].lock);
+	}
+	map->stripe_count = stripe_count;
+	map->segment_size = HASH_TABLE_SIZE / stripe_count;
+}
+
+void destroy_striped_hash_map(StripedHashMap* map) {
+	free(map->entries);
+	_aligned_free(map->stripes);
+}
+
+unsigned int hash_key(int key) {
+	return (unsigned int)key * 2654435761u;
+}
+
+// key가 속한 구역의 락
+AtomicLock* hash_map_lock_of(StripedHashMap* map, int key) {
+	unsigned int home = hash_key(key) % HASH_TABLE_SIZE;
+	return &map->stripes[home / map->segment_size].lock;
+}
+
+// key의 값에 value를 더한다 (없으면 새로 넣는다). 구역이 가득 차면 false
+// 락은 잡지 않는다. 호출하는 쪽이 hash_map_lock_of(map, key)를 가지고 있어야 한다
+bool hash_map_add(StripedHashMap* map, int key, int value) {
+	unsigned int home = hash_key(key) % HASH_TABLE_SIZE;
+	int base = home / map->segment_size * map->segment_size;
+
+	for (int probe = 0; probe < map->segment_size; ++probe) {
+		HashEntry* entry = &map->entries[base + (home - base + probe) % map->segment_size];
+		if (entry->key == key || entry->key == 0) {
+			entry->key = key;
+			entry->value += value;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// 락마다 전용 작업 함수 prefix_hash_map_worker를 만든다 (락 함수가 루프 안으로 인라인된다)
+#define DEFINE_HASH_WORKERS(prefix, lock_fn) \
+	int prefix##_hash_map_worker(void* arg) { \
+		HashThreadData* data = (HashThreadData*)arg; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			int key = next_key(data); \
+			AtomicLock* lock = hash_map_lock_of(data->map, key); \
+			lock_fn(lock); \
+			bool added = hash_map_add(data->map, key, i); \
+			atomic_unlock(lock); \
+			if (!added) { \
+				printf("Hash map segment full\n"); \
+				return 1; \
+			} \
+		} \
+		return 0; \
+	}
+
+DEFINE_HASH_WORKERS(tas, tas_lock)
+DEFINE_HASH_WORKERS(ttas, ttas_lock)
+DEFINE_HASH_WORKERS(back_off, back_off_lock)
+
+// func : DEFINE_HASH_WORKERS가 만든 prefix_hash_map_worker
+void striped_hash_map_test(const char* name, int (*func)(void*), int distribution) {
+	clock_t start;
+	clock_t end;
+	thrd_t threads[SIXTYFOUR];
+	HashThreadData data[SIXTYFOUR];
+	StripedHashMap map;
+
+	for (int s = 0; s < STRIPE_COUNT_NUM; ++s) {
+		int stripe_count = STRIPE_COUNTS[s];
+		printf("%s, %d stripes, %s keys\n", name, stripe_count, distribution == KEYS_UNIFORM ? "uniform" : "zipf");
+		for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+			int n = THREAD_COUNTS[t];
+			init_striped_hash_map(&map, stripe_count);
+
+			// 각각의 스레드에 전달할 데이터 설정
+			for (int i = 0; i < n; ++i) {
+				data[i] = init_hash_thread_data(&map, distribution, i, range_start(i, n), range_end(i, n));
+			}
+
+			for (int i = 0; i < n; ++i) {
+				if (thrd_create(&threads[i], func, &data[i]) != thrd_success) {
+					printf("Error creating thread %d\n", i);
+					return;
+				}
+			}
+			start = clock();
+			for (int i = 0; i < n; ++i) {
+				thrd_join(threads[i], NULL);
+			}
+			end = clock();
+
+			sum = 0;
+			for (int i = 0; i < HASH_TABLE_SIZE; ++i) {
+				sum += map.entries[i].value;
+			}
+			destroy_striped_hash_map(&map);
+
+			double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+			printf("%d threads\n", n);
+			printf("%s Time: %f\n", name, seconds);
+			printf("%s Sum: %llu (%s)\n", name, sum, sum == expected_sum() ? "OK" : "FAIL");
+			STATS_PRINT(name);
+			printf("%s Throughput: %.0f ops/s\n", name, seconds > 0 ? (MAX_NUM - MIN_NUM + 1) / seconds : 0.0);
+		}
+	}
+}
+
+// 비동기 태스크 모드
+// 범위를 수천 개의 작은 태스크(상태 기계)로 나누고, 코어마다 고정된 워커 스레드 하나가 자신의 태스크를 번갈아 실행한다
+// 태스크끼리는 async mutex로 경쟁한다. 락을 얻지 못한 태스크는 스핀하거나 스레드를 재우지 않고 대기열에 들어가서 멈추며,
+// 락을 놓는 태스크가 대기열의 다음 태스크에게 락을 직접 넘기고 그 태스크의 워커에게 다시 실행하라고 알린다
+#define TASK_QUANTUM (64)          // 태스크가 한 번 실행될 때 최대로 처리하는 임계 구역 수 (그 다음 다른 태스크에게 양보)
+#define LATENCY_SAMPLE_EVERY (64)  // 몇 번째 락 획득마다 대기 시간을 기록할지
+
+#define TASK_READY (0)      // 다음 실행 때 락부터 얻어야 함
+#define TASK_OWNS_LOCK (1)  // 대기열에서 깨어남, 이미 락을 넘겨받았음
+
+#define TASK_YIELDED (0)
+#define TASK_SUSPENDED (1)
+#define TASK_DONE (2)
+
+const int TASK_COUNTS[] = { SIXTYFOUR, 256, 1024, 4096 };
+#define TASK_COUNT_NUM (4)
+
+struct Worker;
+
+typedef struct Task {
+	AsyncWaiter waiter; // 첫 번째 멤버 (async_mutex_unlock이 돌려준 AsyncWaiter*를 Task*로 되돌린다)
+	int state;
+	int next;
+	int end;
+	long long wait_start; // 락을 기다리기 시작한 시각 (대기 시간 측정용)
+	struct Worker* worker;
+	struct Task* next_task; // 실행 대기열 연결
+} Task;
+
+typedef struct Worker {
+	alignas(CACHE_LINE) int id;
+	AsyncMutex* mutex;
+	Task* run_head; // 이 워커만 사용하는 실행 대기열
+	Task* run_tail;
+	int remaining;  // 아직 끝나지 않은 태스크 수 (이 워커만 수정)
+	alignas(CACHE_LINE) AtomicLock inbox_lock; // 다른 워커가 깨운 태스크를 넣는 곳
+	Task* inbox_head;
+	Task* inbox_tail;
+	atomic_int inbox_size;
+} Worker;
+
+// 락 획득 대기 시간 샘플 (태스크 모드와 스레드 모드가 같이 사용한다)
+long long* latency_samples;
+atomic_int latency_sample_count;
+int latency_sample_capacity;
+
+void init_latency_samples(void) {
+	latency_sample_capacity = (MAX_NUM - MIN_NUM + 1) / LATENCY_SAMPLE_EVERY + 1;
+	latency_samples = (long long*)malloc(sizeof(long long) * latency_sample_capacity);
+	atomic_init(&latency_sample_count, 0);
+}
+
+void record_latency(int i, long long ticks) {
+	if (i % LATENCY_SAMPLE_EVERY != 0) {
+		return;
+	}
+	int index = atomic_fetch_add_explicit(&latency_sample_count, 1, memory_order_relaxed);
+	if (index < latency_sample_capacity) {
+		latency_samples[index] = ticks;
+	}
+}
+
+int compare_long_long(const void* a, const void* b) {
+	long long x = *(const long long*)a;
+	long long y = *(const long long*)b;
+	return (x > y) - (x < y);
+}
+
+void print_latency_samples(const char* name) {
+	int count = atomic_load(&latency_sample_count);
+	if (count > latency_sample_capacity) {
+		count = latency_sample_capacity;
+	}
+	if (count == 0) {
+		return;
+	}
+	qsort(latency_samples, count, sizeof(long long), compare_long_long);
+	printf("%s Lock wait: p50 %.2f us, p99 %.2f us, max %.2f us\n", name,
+		ticks_to_us(latency_samples[count / 2]), ticks_to_us(latency_samples[count * 99 / 100]), ticks_to_us(latency_samples[count - 1]));
+}
+
+void worker_push_run(Worker* worker, Task* task) {
+	task->next_task = NULL;
+	if (worker->run_tail == NULL) {
+		worker->run_head = task;
+	}
+	else {
+		worker->run_tail->next_task = task;
+	}
+	worker->run_tail = task;
+}
+
+Task* worker_pop_run(Worker* worker) {
+	Task* task = worker->run_head;
+	if (task != NULL) {
+		worker->run_head = task->next_task;
+		if (worker->run_head == NULL) {
+			worker->run_tail = NULL;
+		}
+	}
+	return task;
+}
+
+// 다른 워커에서 깨운 태스크를 원래 워커에게 돌려보낸다
+void worker_wake(Worker* worker, Task* task) {
+	task->next_task = NULL;
+	ttas_lock(&worker->inbox_lock);
+	if (worker->inbox_tail == NULL) {
+		worker->inbox_head = task;
+	}
+	else {
+		worker->inbox_tail->next_task = task;
+	}
+	worker->inbox_tail = task;
+	atomic_fetch_add(&worker->inbox_size, 1);
+	atomic_unlock(&worker->inbox_lock);
+}
+
+void worker_drain_inbox(Worker* worker) {
+	if (atomic_load_explicit(&worker->inbox_size, memory_order_relaxed) == 0) {
+		return;
+	}
+	ttas_lock(&worker->inbox_lock);
+	Task* task = worker->inbox_head;
+	worker->inbox_head = NULL;
+	worker->inbox_tail = NULL;
+	atomic_store(&worker->inbox_size, 0);
+	atomic_unlock(&worker->inbox_lock);
+	while (task != NULL) {
+		Task* next = task->next_task;
+		worker_push_run(worker, task);
+		task = next;
+	}
+}
+
+// 락을 놓고, 대기열에서 락을 넘겨받은 태스크가 있으면 그 태스크의 워커에게 돌려보낸다
+void task_unlock(AsyncMutex* mutex) {
+	Task* next = (Task*)async_mutex_unlock(mutex);
+	if (next != NULL) {
+		worker_wake(next->worker, next);
+	}
+}
+
+int run_task(Task* task, AsyncMutex* mutex) {
+	for (int step = 0; step < TASK_QUANTUM; ++step) {
+		if (task->next > task->end) {
+			return TASK_DONE;
+		}
+		if (task->state == TASK_READY) {
+			task->wait_start = now_ticks();
+			if (!async_mutex_lock(mutex, &task->waiter)) {
+				task->state = TASK_OWNS_LOCK; // 다시 실행될 때는 락을 넘겨받은 상태다
+				return TASK_SUSPENDED;
+			}
+		}
+		else {
+			STATS_ACQUIRED(&mutex->locked); // 대기열에서 락을 넘겨받았다
+		}
+		task->state = TASK_READY;
+		record_latency(task->next, now_ticks() - task->wait_start);
+		sum += task->next;
+		++task->next;
+		task_unlock(mutex);
+	}
+	return task->next > task->end ? TASK_DONE : TASK_YIELDED;
+}
+
+int worker_main(void* arg) {
+	Worker* worker = (Worker*)arg;
+	SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << worker->id);
+
+	while (worker->remaining > 0) {
+		worker_drain_inbox(worker);
+		Task* task = worker_pop_run(worker);
+		if (task == NULL) {
+			// 모든 태스크가 락을 기다리는 중
+			thrd_yield();
+			continue;
+		}
+		int result = run_task(task, worker->mutex);
+		if (result == TASK_DONE) {
+			--worker->remaining;
+		}
+		else if (result == TASK_YIELDED) {
+			worker_push_run(worker, task);
+		}
+	}
+
+	return 0;
+}
+
+void async_task_test(void) {
+	clock_t start;
+	clock_t end;
+	int workers_num = lock_cpu_count() < SIXTYFOUR ? lock_cpu_count() : SIXTYFOUR;
+	thrd_t threads[SIXTYFOUR];
+	Worker* workers = (Worker*)_aligned_malloc(sizeof(Worker) * workers_num, CACHE_LINE);
+	AsyncMutex mutex;
+
+	init_latency_samples();
+	for (int t = 0; t < TASK_COUNT_NUM; ++t) {
+		int n = TASK_COUNTS[t];
+		Task* tasks = (Task*)malloc(sizeof(Task) * n);
+		init_async_mutex(&mutex);
+		atomic_store(&latency_sample_count, 0);
+
+		for (int w = 0; w < workers_num; ++w) {
+			workers[w].id = w;
+			workers[w].mutex = &mutex;
+			workers[w].run_head = NULL;
+			workers[w].run_tail = NULL;
+			workers[w].remaining = 0;
+			init_atomic_lock(&workers[w].inbox_lock);
+			workers[w].inbox_head = NULL;
+			workers[w].inbox_tail = NULL;
+			atomic_init(&workers[w].inbox_size, 0);
+		}
+		// 태스크를 워커에 골고루 나눠 준다
+		for (int i = 0; i < n; ++i) {
+			tasks[i].state = TASK_READY;
+			tasks[i].next = range_start(i, n);
+			tasks[i].end = range_end(i, n);
+			tasks[i].worker = &workers[i % workers_num];
+			worker_push_run(tasks[i].worker, &tasks[i]);
+			++tasks[i].worker->remaining;
+		}
+
+		STATS_NAME(&mutex.locked, "AsyncMutex");
+		STATS_NAME(&mutex.guard, "AsyncMutex guard");
+		for (int w = 0; w < workers_num; ++w) {
+			STATS_NAME(&workers[w].inbox_lock, "inbox");
+		}
+
+		sum = 0;
+		for (int w = 0; w < workers_num; ++w) {
+			if (thrd_create(&threads[w], worker_main, &workers[w]) != thrd_success) {
+				printf("Error creating thread %d\n", w);
+				free(tasks);
+				_aligned_free(workers);
+				return;
+			}
+		}
+		start = clock();
+		for (int w = 0; w < workers_num; ++w) {
+			thrd_join(threads[w], NULL);
+		}
+		end = clock();
+		free(tasks);
+
+		printf("%d tasks on %d workers\n", n, workers_num);
+		printf("AsyncMutex Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
+		printf("AsyncMutex Sum: %llu\n", sum);
+		STATS_PRINT("AsyncMutex");
+		print_latency_samples("AsyncMutex");
+	}
+
+	_aligned_free(workers);
+	free(latency_samples);
+}
+
+// 비교용: 태스크 수와 같은 수의 OS 스레드를 만들고 각 스레드가 ttas_lock으로 경쟁한다 (tas_test 등과 같은 방식)
+int latency_ttas_add(void* arg) {
+	AtomicThreadData* data = (AtomicThreadData*)arg;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		long long wait_start = now_ticks();
+		ttas_lock(data->lock);
+		record_latency(i, now_ticks() - wait_start);
+		sum += i;
+		atomic_unlock(data->lock);
+	}
+
+	return 0;
+}
+
+void thread_per_slice_test(void) {
+	clock_t start;
+	clock_t end;
+	AtomicLock lock;
+
+	init_latency_samples();
+	for (int t = 0; t < TASK_COUNT_NUM; ++t) {
+		int n = TASK_COUNTS[t];
+		thrd_t* threads = (thrd_t*)malloc(sizeof(thrd_t) * n);
+		AtomicThreadData* data = (AtomicThreadData*)malloc(sizeof(AtomicThreadData) * n);
+		init_atomic_lock(&lock);
+		atomic_store(&latency_sample_count, 0);
+
+		// 각각의 스레드에 전달할 데이터 설정
+		for (int i = 0; i < n; ++i) {
+			data[i] = init_atomic_thread_data(&lock, range_start(i, n), range_end(i, n));
+		}
+
+		sum = 0;
+		for (int i = 0; i < n; ++i) {
+			if (thrd_create(&threads[i], latency_ttas_add, &data[i]) != thrd_success) {
+				printf("Error creating thread %d\n", i);
+				free(threads);
+				free(data);
+				return;
+			}
+		}
+		start = clock();
+		for (int i = 0; i < n; ++i) {
+			thrd_join(threads[i], NULL);
+		}
+		end = clock();
+		free(threads);
+		free(data);
+
+		printf("%d threads\n", n);
+		printf("TTASLock Time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
+		printf("TTASLock Sum: %llu\n", sum);
+		STATS_PRINT("TTASLock");
+		print_latency_samples("TTASLock");
+	}
+
+	free(latency_samples);
+}
+
+#ifdef LOCK_TRACE
+// 락마다 몇 가지 스레드 수로 실행하면서 trace_<락 이름>_<스레드 수>.json 파일을 만든다
+const int TRACE_THREAD_COUNTS[] = { FOUR, SIXTEEN };
+#define TRACE_THREAD_COUNT_NUM (2)
+
+void trace_test(void) {
+	thrd_t threads[SIXTEEN];
+	OversubThreadData* data = (OversubThreadData*)_aligned_malloc(sizeof(OversubThreadData) * SIXTEEN, CACHE_LINE);
+	OversubLocks locks;
+	char path[64];
+
+	for (int kind = 0; kind < LOCK_KIND_NUM; ++kind) {
+		for (int t = 0; t < TRACE_THREAD_COUNT_NUM; ++t) {
+			int n = TRACE_THREAD_COUNTS[t];
+			init_oversub_locks(&locks);
+
+			// 각각의 스레드에 전달할 데이터 설정
+			for (int i = 0; i < n; ++i) {
+				data[i] = init_oversub_thread_data(&locks, kind, PREEMPT_NONE, range_start(i, n), range_end(i, n));
+			}
+
+			sum = 0;
+			trace_start();
+			for (int i = 0; i < n; ++i) {
+				if (thrd_create(&threads[i], OVERSUB_WORKERS[kind], &data[i]) != thrd_success) {
+					printf("Error creating thread %d\n", i);
+					trace_stop();
+					_aligned_free(data);
+					return;
+				}
+			}
+			for (int i = 0; i < n; ++i) {
+				thrd_join(threads[i], NULL);
+			}
+			trace_stop();
+			destroy_to_lock(&locks.to);
+
+			snprintf(path, sizeof(path), "trace_%s_%d.json", LOCK_NAMES[kind], n);
+			trace_dump(path);
+			printf("%d threads\n", n);
+			printf("%s Sum: %llu, trace: %s\n", LOCK_NAMES[kind], sum, path);
+		}
+	}
+
+	_aligned_free(data);
+}
+#endif
+
+// 인라인 락 라이브러리 벤치마크
+// 같은 락을 함수 포인터로 부르는 작업 함수(call_add)와, 락 함수가 루프 안으로 인라인되도록 락마다 따로 만든 작업 함수를 비교한다
+// 차이가 호출 비용이고, 인라인 버전의 시간이 락 자체의 비용에 더 가깝다
+typedef struct InlineThreadData {
+	void* lock;
+	void (*lock_func)(void*);
+	void (*unlock_func)(void*);
+	int start;
+	int end;
+} InlineThreadData;
+
+InlineThreadData init_inline_thread_data(void* lock, void (*lock_func)(void*), void (*unlock_func)(void*), int start, int end) {
+	InlineThreadData d;
+	d.lock = lock;
+	d.lock_func = lock_func;
+	d.unlock_func = unlock_func;
+	d.start = start;
+	d.end = end;
+
+	return d;
+}
+
+int call_add(void* arg) {
+	InlineThreadData* data = (InlineThreadData*)arg;
+
+	for (int i = data->start; i <= data->end; ++i) {
+		data->lock_func(data->lock);
+		sum += i;
+		data->unlock_func(data->lock);
+	}
+
+	return 0;
+}
+
+// prefix_lock_call / prefix_unlock_call : call_add에서 함수 포인터로 부르는 함수
+// prefix_inline_add : lock_fn과 unlock_fn이 직접 들어간 전용 작업 함수
+#define DEFINE_LOCK_WORKERS(prefix, LockType, lock_fn, unlock_fn) \
+	void prefix##_lock_call(void* lock) { \
+		lock_fn((LockType*)lock); \
+	} \
+	void prefix##_unlock_call(void* lock) { \
+		unlock_fn((LockType*)lock); \
+	} \
+	int prefix##_inline_add(void* arg) { \
+		InlineThreadData* data = (InlineThreadData*)arg; \
+		LockType* lock = (LockType*)data->lock; \
+		for (int i = data->start; i <= data->end; ++i) { \
+			lock_fn(lock); \
+			sum += i; \
+			unlock_fn(lock); \
+		} \
+		return 0; \
+	}
+
+DEFINE_LOCK_WORKERS(tas, AtomicLock, tas_lock, atomic_unlock)
+DEFINE_LOCK_WORKERS(ttas, AtomicLock, ttas_lock, atomic_unlock)
+DEFINE_LOCK_WORKERS(back_off, AtomicLock, back_off_lock, atomic_unlock)
+DEFINE_LOCK_WORKERS(ticket, TicketLock, ticket_lock, ticket_unlock)
+DEFINE_LOCK_WORKERS(adaptive, AdaptiveLock, adaptive_lock, adaptive_unlock)
+
+typedef struct InlineVariant {
+	int kind; // LOCK_*
+	void (*lock_func)(void*);
+	void (*unlock_func)(void*);
+	int (*inline_func)(void*);
+} InlineVariant;
+
+const InlineVariant INLINE_VARIANTS[] = {
+	{ LOCK_TAS, tas_lock_call, tas_unlock_call, tas_inline_add },
+	{ LOCK_TTAS, ttas_lock_call, ttas_unlock_call, ttas_inline_add },
+	{ LOCK_BACK_OFF, back_off_lock_call, back_off_unlock_call, back_off_inline_add },
+	{ LOCK_TICKET, ticket_lock_call, ticket_unlock_call, ticket_inline_add },
+	{ LOCK_ADAPTIVE, adaptive_lock_call, adaptive_unlock_call, adaptive_inline_add },
+};
+#define INLINE_VARIANT_NUM (5)
+
+void* inline_lock_of(OversubLocks* locks, int kind) {
+	switch (kind) {
+	case LOCK_TICKET:
+		return &locks->ticket;
+	case LOCK_ADAPTIVE:
+		return &locks->adaptive;
+	default:
+		return &locks->atomic;
+	}
+}
+
+// n개의 스레드로 func를 실행하고 걸린 시간(초)을 반환한다 (스레드 생성에 실패하면 음수)
+double inline_run(int (*func)(void*), const InlineVariant* variant, int n) {
+	thrd_t threads[SIXTYFOUR];
+	InlineThreadData data[SIXTYFOUR];
+	OversubLocks locks;
+	clock_t start;
+	clock_t end;
+
+	init_oversub_locks(&locks);
+	// 각각의 스레드에 전달할 데이터 설정
+	for (int i = 0; i < n; ++i) {
+		data[i] = init_inline_thread_data(inline_lock_of(&locks, variant->kind), variant->lock_func, variant->unlock_func,
+			range_start(i, n), range_end(i, n));
+	}
+
+	sum = 0;
+	for (int i = 0; i < n; ++i) {
+		if (thrd_create(&threads[i], func, &data[i]) != thrd_success) {
+			printf("Error creating thread %d\n", i);
+			return -1.0;
+		}
+	}
+	start = clock();
+	for (int i = 0; i < n; ++i) {
+		thrd_join(threads[i], NULL);
+	}
+	end = clock();
+	destroy_to_lock(&locks.to);
+
+	return (double)(end - start) / CLOCKS_PER_SEC;
+}
+
+void inline_test(void) {
+	for (int v = 0; v < INLINE_VARIANT_NUM; ++v) {
+		const InlineVariant* variant = &INLINE_VARIANTS[v];
+		const char* name = LOCK_NAMES[variant->kind];
+		for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+			int n = THREAD_COUNTS[t];
+			printf("%d threads\n", n);
+
+			double call_time = inline_run(call_add, variant, n);
+			if (call_time < 0) {
+				return;
+			}
+			printf("%s (call) Time: %f\n", name, call_time);
+			printf("%s (call) Sum: %llu\n", name, sum);
+			STATS_PRINT(name);
+
+			double inline_time = inline_run(variant->inline_func, variant, n);
+			if (inline_time < 0) {
+				return;
+			}
+			printf("%s (inline) Time: %f\n", name, inline_time);
+			printf("%s (inline) Sum: %llu\n", name, sum);
+			STATS_PRINT(name);
+			printf("%s Speedup: %.2f\n", name, inline_time > 0 ? call_time / inline_time : 0.0);
+		}
+	}
+}
+
+// 배리어 테스트
+// MIN_NUM ~ MAX_NUM을 BARRIER_ROUNDS개의 구간으로 나누고, 라운드마다 각 스레드가 그 구간의 일부를 더한 뒤 배리어에서 기다린다
+// 라운드당 일이 적으므로 시간은 대부분 배리어 비용이다
+#define BARRIER_ROUNDS (1000)
+
+#define BARRIER_SENSE (0)
+#define BARRIER_TREE (1)
+#define BARRIER_DISSEMINATION (2)
+#define BARRIER_FUTEX (3)
+#define BARRIER_KIND_NUM (4)
+
+const char* BARRIER_NAMES[BARRIER_KIND_NUM] = { "SenseBarrier", "TreeBarrier", "DisseminationBarrier", "FutexBarrier" };
+
+typedef struct Barriers {
+	SenseBarrier sense;
+	TreeBarrier tree;
+	DisseminationBarrier dissemination;
+	FutexBarrier futex;
+} Barriers;
+
+typedef struct BarrierThreadData {
+	alignas(CACHE_LINE) BarrierLocal local; // 스레드가 자주 수정한다 (구조체가 캐시 라인에서 시작하고 크기도 CACHE_LINE의 배수가 된다)
+	Barriers* barriers;
+	int kind;
+	int n;
+	unsigned long long partial; // 이 스레드가 더한 값 (모든 라운드가 끝난 뒤에 합친다)
+	long long wait_ticks;       // 배리어에서 기다린 시간의 합
+} BarrierThreadData;
+
+BarrierThreadData init_barrier_thread_data(Barriers* barriers, int kind, int id, int n) {
+	BarrierThreadData d;
+	d.local = init_barrier_local(id);
+	d.barriers = barriers;
+	d.kind = kind;
+	d.n = n;
+	d.partial = 0;
+	d.wait_ticks = 0;
+
+	return d;
+}
+
+// 하나라도 초기화하지 못하면 이미 할당한 것을 풀고 false
+bool init_barriers(Barriers* barriers, int n) {
+	init_sense_barrier(&barriers->sense, n);
+	init_futex_barrier(&barriers->futex, n);
+	if (!init_tree_barrier(&barriers->tree, n)) {
+		return false;
+	}
+	if (!init_dissemination_barrier(&barriers->dissemination, n)) {
+		destroy_tree_barrier(&barriers->tree);
+		return false;
+	}
+
+	return true;
+}
+
+void destroy_barriers(Barriers* barriers) {
+	destroy_tree_barrier(&barriers->tree);
+	destroy_dissemination_barrier(&barriers->dissemination);
+}
+
+void barrier_wait(BarrierThreadData* data) {
+	switch (data->kind) {
+	case BARRIER_SENSE:
+		sense_barrier_wait(&data->barriers->sense, &data->local);
+		break;
+	case BARRIER_TREE:
+		tree_barrier_wait(&data->barriers->tree, &data->local);
+		break;
+	case BARRIER_DISSEMINATION:
+		dissemination_barrier_wait(&data->barriers->dissemination, &data->local);
+		break;
+	default:
+		futex_barrier_wait(&data->barriers->futex, &data->local);
+		break;
+	}
+}
+
+int barrier_add(void* arg) {
+	BarrierThreadData* data = (BarrierThreadData*)arg;
+	long long total = (long long)MAX_NUM - MIN_NUM + 1;
+
+	for (int round = 0; round < BARRIER_ROUNDS; ++round) {
+		// 이번 라운드의 구간 중 이 스레드가 맡은 부분
+		long long round_start = MIN_NUM + total * round / BARRIER_ROUNDS;
+		long long round_length = MIN_NUM + total * (round + 1) / BARRIER_ROUNDS - round_start;
+		long long start = round_start + round_length * data->local.id / data->n;
+		long long end = round_start + round_length * (data->local.id + 1) / data->n;
+		for (long long i = start; i < end; ++i) {
+			data->partial += i;
+		}
+
+		long long wait_start = now_ticks();
+		barrier_wait(data);
+		data->wait_ticks += now_ticks() - wait_start;
+	}
+
+	return 0;
+}
+
+void barrier_test(void) {
+	thrd_t threads[SIXTYFOUR];
+	BarrierThreadData* data = (BarrierThreadData*)_aligned_malloc(sizeof(BarrierThreadData) * SIXTYFOUR, CACHE_LINE);
+	Barriers barriers;
+
+	for (int kind = 0; kind < BARRIER_KIND_NUM; ++kind) {
+		for (int t = 0; t < THREAD_COUNT_NUM; ++t) {
+			int n = THREAD_COUNTS[t];
+			if (!init_barriers(&barriers, n)) {
+				printf("Error initializing barriers for %d threads\n", n);
+				_aligned_free(data);
+				return;
+			}
+
+			// 각각의 스레드에 전달할 데이터 설정
+			for (int i = 0; i < n; ++i) {
+				data[i] = init_barrier_thread_data(&barriers, kind, i, n);
+			}
+
+			long long start = now_ticks();
+			for (int i = 0; i < n; ++i) {
+				if (thrd_create(&threads[i], barrier_add, &data[i]) != thrd_success) {
+					printf("Error creating thread %d\n", i);
+					destroy_barriers(&barriers);
+					_aligned_free(data);
+					return;
+				}
+			}
+			for (int i = 0; i < n; ++i) {
+				thrd_join(threads[i], NULL);
+			}
+			long long end = now_ticks();
+			destroy_barriers(&barriers);
+
+			sum = 0;
+			long long wait_ticks = 0;
+			for (int i = 0; i < n; ++i) {
+				sum += data[i].partial;
+				wait_ticks += data[i].wait_ticks;
+			}
+			double round_us = ticks_to_us(end - start) / BARRIER_ROUNDS;
+			printf("%d threads\n", n);
+			printf("%s Time: %f\n", BARRIER_NAMES[kind], ticks_to_us(end - start) / 1e6);
+			printf("%s Sum: %llu (%s)\n", BARRIER_NAMES[kind], sum, sum == expected_sum() ? "OK" : "FAIL");
+			printf("%s Latency: avg wait %.2f us, round %.2f us\n", BARRIER_NAMES[kind],
+				ticks_to_us(wait_ticks) / ((double)n * BARRIER_ROUNDS), round_us);
+		}
+	}
+
+	_aligned_free(data);
+}
+
+int main(void) {
+	clock_t start;
+	clock_t end;
+
+	start = clock();
+	for (int i = MIN_NUM; i <= MAX_NUM; ++i) {
+		sum += i;
+	}
+	end = clock();
+
+	printf("Single thread time: %f\n", (double)(end - start) / CLOCKS_PER_SEC);
+	printf("Sum: %llu\n", sum);
+
+    printf("\n===NoLock test===\n");
+    no_lock_test();
+    printf("\n===SpinLock test===\n");
+    spin_lock_test();
+	printf("\n===TASLock test===\n");
+	tas_test();
+	printf("\n===TTASLock test===\n");
+	ttas_test();
+	printf("\n===Back-off test===\n");
+	back_off_test();
+	printf("\n===RWLock test (%d%% write)===\n", WRITE_PERCENT);
+	rw_test(rw_add, "RWLock", WRITE_PERCENT);
+	printf("\n===Writer-preferring RWLock test (%d%% write)===\n", WRITE_PERCENT);
+	rw_test(rw_pref_add, "WriterPrefRWLock", WRITE_PERCENT);
+	printf("\n===BigReaderLock test (%d%% write)===\n", WRITE_PERCENT);
+	big_reader_test(WRITE_PERCENT);
+	printf("\n===SeqLock test (%d%% write)===\n", WRITE_PERCENT);
+	seq_lock_test(WRITE_PERCENT);
+	printf("\n===RWLock snapshot test (%d%% write)===\n", WRITE_PERCENT);
+	rw_snapshot_test(WRITE_PERCENT);
+	printf("\n===TryLock test===\n");
+	try_test(tas_try_add, "TASLock trylock");
+	try_test(ttas_try_add, "TTASLock trylock");
+	try_test(back_off_try_add, "Backoff trylock");
+	to_lock_test(to_try_add, "TOLock trylock");
+	printf("\n===Timed lock test===\n");
+	try_test(tas_timeout_add, "TASLock timeout");
+	try_test(ttas_timeout_add, "TTASLock timeout");
+	try_test(back_off_timeout_add, "Backoff timeout");
+	to_lock_test(to_timeout_add, "TOLock timeout");
+	printf("\n===TOLock abort recovery test===\n");
+	to_abort_recovery_test();
+	printf("\n===Stack test===\n");
+	ds_test(lock_free_stack_add, "Treiber stack", DS_LOCK_FREE_STACK);
+	ds_test(tas_stack_add, "TASLock stack", DS_LOCKED_STACK);
+	ds_test(ttas_stack_add, "TTASLock stack", DS_LOCKED_STACK);
+	ds_test(back_off_stack_add, "Backoff stack", DS_LOCKED_STACK);
+	printf("\n===Queue test===\n");
+	ds_test(lock_free_queue_add, "Michael-Scott queue", DS_LOCK_FREE_QUEUE);
+	ds_test(tas_queue_add, "TASLock queue", DS_LOCKED_QUEUE);
+	ds_test(ttas_queue_add, "TTASLock queue", DS_LOCKED_QUEUE);
+	ds_test(back_off_queue_add, "Backoff queue", DS_LOCKED_QUEUE);
+	printf("\n===Pipeline test===\n");
+	pipeline_test(RING_SPSC, "SPSC ring");
+	pipeline_test(RING_MPMC, "MPMC ring");
+	pipeline_test(RING_LOCKED, "Mutex+condvar ring");
+	printf("\n===Oversubscription test===\n");
+	oversub_test(PREEMPT_NONE);
+	printf("\n===Oversubscription test (holder yields every %d ops)===\n", PREEMPT_INTERVAL);
+	oversub_test(PREEMPT_YIELD);
+	printf("\n===Oversubscription test (holder delays every %d ops)===\n", PREEMPT_INTERVAL);
+	oversub_test(PREEMPT_DELAY);
+	printf("\n===Cache line layout test===\n");
+	for (int lock_layout = LAYOUT_COLOCATED; lock_layout <= LAYOUT_SEPARATED; ++lock_layout) {
+		layout_test("TASLock", tas_layout_add, lock_layout, false);
+		layout_test("TASLock", tas_layout_add, lock_layout, true);
+		layout_test("TTASLock", ttas_layout_add, lock_layout, false);
+		layout_test("TTASLock", ttas_layout_add, lock_layout, true);
+	}
+	printf("\n===Memory ordering test===\n");
+	ordering_test();
+	printf("\n===Striped hash map test===\n");
+	init_zipf_cdf();
+	for (int distribution = KEYS_UNIFORM; distribution <= KEYS_ZIPF; ++distribution) {
+		striped_hash_map_test("TASLock", tas_hash_map_worker, distribution);
+		striped_hash_map_test("TTASLock", ttas_hash_map_worker, distribution);
+		striped_hash_map_test("Backoff", back_off_hash_map_worker, distribution);
+	}
+	printf("\n===Async task test===\n");
+	async_task_test();
+	printf("\n===Thread-per-slice test===\n");
+	thread_per_slice_test();
+#ifdef LOCK_TRACE
+	printf("\n===Lock trace===\n");
+	trace_test();
+#endif
+	printf("\n===CPU efficiency test===\n");
+	efficiency_test();
+	printf("\n===Adaptive lock test===\n");
+	adaptive_test();
+	printf("\n===Inline lock library test===\n");
+	inline_test();
+	printf("\n===Barrier test (%d rounds)===\n", BARRIER_ROUNDS);
+	barrier_test();
 
 	return 0;
 }